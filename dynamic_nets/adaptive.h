@@ -0,0 +1,96 @@
+/*
+ * adaptive.h
+ *
+ * Adaptive run counts. Rather than a fixed number of runs for every
+ * parameter point and ant, runs are handed out until the confidence
+ * interval of the chosen statistic is narrow enough (or a cap is hit),
+ * so outputs that converge quickly stop early and the remaining work
+ * goes to those that still need it.
+ */
+
+#ifndef DN_ADAPTIVE_H
+#define DN_ADAPTIVE_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <aggregate.h>
+
+using namespace std;
+
+/**
+ * Target for the confidence interval of a statistic: the mean final size
+ * (final), every point of the infected curve (curve) or both (all).
+ */
+struct CITarget {
+   double width;
+   string stat;
+
+   CITarget () : width(0.0), stat("final") { }
+
+   /** Whether the statistic is recognised. */
+   bool valid () const { return stat == "final" || stat == "curve" || stat == "all"; }
+
+   /** Whether the aggregate's confidence interval is within the target. */
+   bool met (RunAggregate &agg) const {
+      if ((stat == "final" || stat == "all") && agg.finalWidth() > width) { return false; }
+      if ((stat == "curve" || stat == "all") && agg.curveWidth() > width) { return false; }
+      return true;
+   }
+};
+
+/**
+ * Hands out runs to a number of outputs in turn, skipping outputs that
+ * have met their target or used their maximum number of runs. Runs of an
+ * output are numbered from 0 so common random numbers still apply. Safe
+ * to use from any number of threads.
+ */
+class AdaptiveScheduler {
+private:
+   mutex m_mutex;
+   int m_minRuns;
+   int m_maxRuns;
+   vector<int> m_issued;
+   vector<int> m_done;
+   vector<bool> m_converged;
+   /** Output to try first on the next request. */
+   int m_next;
+
+public:
+   AdaptiveScheduler (int outputs, int minRuns, int maxRuns) : m_minRuns(min(minRuns, maxRuns)), m_maxRuns(maxRuns),
+      m_issued(outputs, 0), m_done(outputs, 0), m_converged(outputs, false), m_next(0) { }
+
+   /**
+    * Next run to simulate. Returns false once no output needs more runs
+    * (runs already handed out may still be completing).
+    */
+   bool next (int &output, int &run) {
+      lock_guard<mutex> lock(m_mutex);
+      int n = m_issued.size();
+      for (int k = 0; k < n; ++k) {
+         int o = (m_next + k) % n;
+         if (!m_converged[o] && m_issued[o] < m_maxRuns) {
+            output = o;
+            run = m_issued[o]++;
+            m_next = (o + 1) % n;
+            return true;
+         }
+      }
+      return false;
+   }
+
+   /**
+    * Record a completed run of an output and whether its target was met
+    * (only counted after the minimum number of runs). Returns true for
+    * the run that completes the output, once no more will be handed out
+    * and every run handed out has been completed.
+    */
+   bool complete (int output, bool met) {
+      lock_guard<mutex> lock(m_mutex);
+      ++m_done[output];
+      if (met && m_done[output] >= m_minRuns) { m_converged[output] = true; }
+      return (m_converged[output] || m_issued[output] == m_maxRuns) && m_done[output] == m_issued[output];
+   }
+};
+
+#endif // DN_ADAPTIVE_H
@@ -0,0 +1,464 @@
+/*
+ * aggregate.h
+ *
+ * Online statistics over many runs. Rather than keeping every run's
+ * trajectory, each run is reduced to a small trace which is folded into
+ * running accumulators and then discarded.
+ */
+
+#ifndef DN_AGGREGATE_H
+#define DN_AGGREGATE_H
+
+#include <cmath>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <ostream>
+#include <algorithm>
+#include <netevo.h>
+
+using namespace std;
+using namespace netevo;
+
+/**
+ * Running mean and variance (Welford). Two accumulators can be merged
+ * (Chan et al.) so partial results from threads or processes combine.
+ */
+struct Welford {
+   unsigned long n;
+   double mean;
+   double m2;
+
+   Welford () : n(0), mean(0.0), m2(0.0) { }
+
+   void add (double x) {
+      ++n;
+      double delta = x - mean;
+      mean += delta / n;
+      m2 += delta * (x - mean);
+   }
+
+   void merge (const Welford &other) {
+      if (other.n == 0) { return; }
+      unsigned long total = n + other.n;
+      double delta = other.mean - mean;
+      mean += delta * other.n / total;
+      m2 += other.m2 + delta * delta * ((double)n * other.n / total);
+      n = total;
+   }
+
+   double variance () const { return (n > 1) ? m2 / (n - 1) : 0.0; }
+
+   /** Width of the 95% confidence interval of the mean (normal approximation; infinite below two values). */
+   double ciWidth () const { return (n > 1) ? 2.0 * 1.96 * sqrt(variance() / n) : HUGE_VAL; }
+
+   /** Append to / read back from a flat buffer (for sending between processes). */
+   void pack (vector<double> &buf) const {
+      buf.push_back(n);
+      buf.push_back(mean);
+      buf.push_back(m2);
+   }
+   void unpack (const double *&buf) {
+      n = (unsigned long)*buf++;
+      mean = *buf++;
+      m2 = *buf++;
+   }
+};
+
+/**
+ * Quantile sketch for non-negative integers (infected counts and step
+ * numbers). Values are counted in bins, so the memory is fixed and
+ * sketches merge by addition. With one bin per value quantiles are exact;
+ * given a limit on the bins each covers an equal range of values and a
+ * quantile is the largest value of its bin, so at most a bin width high.
+ */
+struct CountSketch {
+   vector<unsigned long> counts;
+   unsigned long n;
+   int maxValue;
+   int width;
+
+   CountSketch () : n(0), maxValue(0), width(1) { }
+   CountSketch (int maxValue, int maxBins = 0) : n(0), maxValue(maxValue), width(1) {
+      if (maxBins > 0 && maxValue + 1 > maxBins) { width = (maxValue + maxBins) / maxBins; }
+      counts.assign(maxValue / width + 1, 0);
+   }
+
+   void add (int value) {
+      if (value < 0) { value = 0; }
+      if (value > maxValue) { value = maxValue; }
+      ++counts[value / width];
+      ++n;
+   }
+
+   void merge (const CountSketch &other) {
+      for (int i=0; i<counts.size() && i<other.counts.size(); ++i) {
+         counts[i] += other.counts[i];
+      }
+      n += other.n;
+   }
+
+   /** Append to / read back from a flat buffer (the sizes must already match). */
+   void pack (vector<double> &buf) const {
+      for (int i=0; i<counts.size(); ++i) { buf.push_back(counts[i]); }
+      buf.push_back(n);
+   }
+   void unpack (const double *&buf) {
+      for (int i=0; i<counts.size(); ++i) { counts[i] = (unsigned long)*buf++; }
+      n = (unsigned long)*buf++;
+   }
+
+   /** Smallest value v such that at least a fraction q of observations are <= v. */
+   int quantile (double q) const {
+      if (n == 0) { return -1; }
+      unsigned long target = (unsigned long)ceil(q * n);
+      if (target < 1) { target = 1; }
+      unsigned long sum = 0;
+      for (int i=0; i<counts.size(); ++i) {
+         sum += counts[i];
+         if (sum >= target) { return min(i * width + width - 1, maxValue); }
+      }
+      return maxValue;
+   }
+};
+
+/**
+ * Bins of the sketches of the infected count at each output step and of
+ * the time to reach each fraction, which would otherwise grow with the
+ * number of nodes and the length of the runs. The final size is exact.
+ */
+static const int CURVE_SKETCH_BINS = 64;
+static const int REACH_SKETCH_BINS = 1024;
+
+/** Quantiles reported in summaries. */
+static const double SUMMARY_QUANTILES[] = { 0.05, 0.25, 0.5, 0.75, 0.95 };
+static const int SUMMARY_NUM_QUANTILES = 5;
+
+/**
+ * Reduced form of a single run: the infected count at every output step
+ * and the step at which each node was infected. Observations may fall
+ * between steps; an output step that is not observed directly takes the
+ * state observed before it.
+ */
+class SimObserverRunTrace : public SimObserver {
+private:
+   vector<int> m_rowSteps;
+   int m_nextRow;
+   /** Original number of each node (empty if the nodes keep their numbers). */
+   vector<int> m_labels;
+public:
+   /** Infected count at each output row (only rows reached are filled). */
+   vector<int> infected;
+   /** Step at which each node (by original number) became infected (-1 if never). */
+   vector<int> infectedStep;
+   /** Infected count and time (in steps) at the last observation. */
+   int lastCount;
+   double lastTime;
+
+   SimObserverRunTrace (const vector<int> &rowSteps, int nodes, const vector<int> &labels = vector<int>()) : 
+      m_rowSteps(rowSteps), m_nextRow(0), m_labels(labels), infectedStep(nodes, -1), lastCount(0), lastTime(0.0) {
+      infected.reserve(rowSteps.size());
+   }
+
+   /** Record at a different set of output steps from the next run. */
+   void setRowSteps (const vector<int> &rowSteps) {
+      m_rowSteps.assign(rowSteps.begin(), rowSteps.end());
+      infected.reserve(rowSteps.size());
+   }
+
+   /** Prepare for a new run. */
+   void reset () {
+      m_nextRow = 0;
+      infected.clear();
+      fill(infectedStep.begin(), infectedStep.end(), -1);
+      lastCount = 0;
+      lastTime = 0.0;
+   }
+
+   void operator() (const State &x, double t) {
+      int i, step = (int)t, count = 0;
+
+      // Rows passed since the last observation held the previous state
+      while (m_nextRow < m_rowSteps.size() && m_rowSteps[m_nextRow] < t) {
+         infected.push_back(lastCount);
+         ++m_nextRow;
+      }
+
+      for (i=0; i<infectedStep.size(); ++i) {
+         if (x[i] != 0.0) {
+            int node = m_labels.empty() ? i : m_labels[i];
+            ++count;
+            if (infectedStep[node] < 0) { infectedStep[node] = step; }
+         }
+      }
+      lastCount = count;
+      lastTime = t;
+
+      if (m_nextRow < m_rowSteps.size() && m_rowSteps[m_nextRow] == t) {
+         infected.push_back(count);
+         ++m_nextRow;
+      }
+   }
+};
+
+/**
+ * Statistics for one (parameter point, ant) over all of its runs:
+ *  - infected count at each output step (mean, variance, quantiles),
+ *  - final size,
+ *  - probability (and mean time) of each node becoming infected,
+ *  - time for a given fraction of the nodes to become infected.
+ * Runs are folded in under a lock so any thread may add a run.
+ */
+class RunAggregate {
+private:
+   mutex m_mutex;
+   int m_nodes;
+   vector<int> m_rowSteps;
+   vector<double> m_fractions;
+   unsigned long m_runs;
+
+   vector<Welford> m_curve;
+   vector<CountSketch> m_curveSketch;
+   Welford m_final;
+   CountSketch m_finalSketch;
+   vector<unsigned long> m_nodeInfected;
+   vector<Welford> m_nodeTime;
+   vector<Welford> m_reachTime;
+   vector<CountSketch> m_reachSketch;
+
+public:
+   /**
+    * Constructor. Must supply the number of nodes, the steps that are
+    * output (in order) and the fractions of infected nodes to time.
+    */
+   RunAggregate (int nodes, const vector<int> &rowSteps, const vector<double> &fractions) : m_nodes(nodes),
+      m_rowSteps(rowSteps), m_fractions(fractions), m_runs(0), m_curve(rowSteps.size()),
+      m_curveSketch(rowSteps.size(), CountSketch(nodes, CURVE_SKETCH_BINS)), m_finalSketch(nodes),
+      m_nodeInfected(nodes, 0), m_nodeTime(nodes), m_reachTime(fractions.size()),
+      m_reachSketch(fractions.size(), CountSketch(rowSteps.empty() ? 0 : rowSteps.back(), REACH_SKETCH_BINS)) { }
+
+   /** Steps at which the infected count is summarised. */
+   const vector<int> & rowSteps () const { return m_rowSteps; }
+
+   /** Number of runs added so far. */
+   unsigned long runs () { lock_guard<mutex> lock(m_mutex); return m_runs; }
+
+   /**
+    * Fold a completed run into the statistics. Returns the number of runs
+    * added so far, including this one, so that only one of several threads
+    * adding runs sees the last.
+    */
+   unsigned long add (const SimObserverRunTrace &trace) {
+      int i, k;
+      lock_guard<mutex> lock(m_mutex);
+      ++m_runs;
+
+      // Rows after the run stopped keep the last state
+      for (i=0; i<m_rowSteps.size(); ++i) {
+         int count = (i < trace.infected.size()) ? trace.infected[i] : trace.lastCount;
+         m_curve[i].add(count);
+         m_curveSketch[i].add(count);
+      }
+      m_final.add(trace.lastCount);
+      m_finalSketch.add(trace.lastCount);
+
+      // Per node infection and the order nodes were infected in
+      vector<int> steps;
+      steps.reserve(m_nodes);
+      for (i=0; i<m_nodes; ++i) {
+         if (trace.infectedStep[i] >= 0) {
+            ++m_nodeInfected[i];
+            m_nodeTime[i].add(trace.infectedStep[i]);
+            steps.push_back(trace.infectedStep[i]);
+         }
+      }
+      sort(steps.begin(), steps.end());
+      for (k=0; k<m_fractions.size(); ++k) {
+         int needed = (int)ceil(m_fractions[k] * m_nodes);
+         if (needed < 1) { needed = 1; }
+         if (needed <= steps.size()) {
+            m_reachTime[k].add(steps[needed-1]);
+            m_reachSketch[k].add(steps[needed-1]);
+         }
+      }
+      return m_runs;
+   }
+
+   /** Merge another aggregate over the same point and ant into this one. */
+   void merge (RunAggregate &other) {
+      int i;
+      lock_guard<mutex> lock(m_mutex);
+      lock_guard<mutex> otherLock(other.m_mutex);
+      m_runs += other.m_runs;
+      for (i=0; i<m_curve.size(); ++i) {
+         m_curve[i].merge(other.m_curve[i]);
+         m_curveSketch[i].merge(other.m_curveSketch[i]);
+      }
+      m_final.merge(other.m_final);
+      m_finalSketch.merge(other.m_finalSketch);
+      for (i=0; i<m_nodes; ++i) {
+         m_nodeInfected[i] += other.m_nodeInfected[i];
+         m_nodeTime[i].merge(other.m_nodeTime[i]);
+      }
+      for (i=0; i<m_fractions.size(); ++i) {
+         m_reachTime[i].merge(other.m_reachTime[i]);
+         m_reachSketch[i].merge(other.m_reachSketch[i]);
+      }
+   }
+
+   /**
+    * Append the statistics to a flat buffer, or replace them with those
+    * read back from one, so partial results can be sent between processes.
+    * Both ends must be constructed with the same nodes, steps and fractions.
+    */
+   void pack (vector<double> &buf) {
+      int i;
+      lock_guard<mutex> lock(m_mutex);
+      buf.push_back(m_runs);
+      for (i=0; i<m_curve.size(); ++i) {
+         m_curve[i].pack(buf);
+         m_curveSketch[i].pack(buf);
+      }
+      m_final.pack(buf);
+      m_finalSketch.pack(buf);
+      for (i=0; i<m_nodes; ++i) {
+         buf.push_back(m_nodeInfected[i]);
+         m_nodeTime[i].pack(buf);
+      }
+      for (i=0; i<m_fractions.size(); ++i) {
+         m_reachTime[i].pack(buf);
+         m_reachSketch[i].pack(buf);
+      }
+   }
+   void unpack (const double *&buf) {
+      int i;
+      lock_guard<mutex> lock(m_mutex);
+      m_runs = (unsigned long)*buf++;
+      for (i=0; i<m_curve.size(); ++i) {
+         m_curve[i].unpack(buf);
+         m_curveSketch[i].unpack(buf);
+      }
+      m_final.unpack(buf);
+      m_finalSketch.unpack(buf);
+      for (i=0; i<m_nodes; ++i) {
+         m_nodeInfected[i] = (unsigned long)*buf++;
+         m_nodeTime[i].unpack(buf);
+      }
+      for (i=0; i<m_fractions.size(); ++i) {
+         m_reachTime[i].unpack(buf);
+         m_reachSketch[i].unpack(buf);
+      }
+   }
+
+   /** Widths of the confidence intervals of the mean final size and the widest over the curve. */
+   double finalWidth () { lock_guard<mutex> lock(m_mutex); return m_final.ciWidth(); }
+   double curveWidth () {
+      lock_guard<mutex> lock(m_mutex);
+      double width = 0.0;
+      for (int i=0; i<m_curve.size(); ++i) { width = max(width, m_curve[i].ciWidth()); }
+      return width;
+   }
+
+   /** Accessors for the final size statistics. */
+   const Welford & finalSize () const { return m_final; }
+   const CountSketch & finalSizeSketch () const { return m_finalSketch; }
+   const vector<Welford> & curve () const { return m_curve; }
+   const vector<unsigned long> & nodeInfected () const { return m_nodeInfected; }
+
+   /**
+    * Write the summary as CSV records, each tagged with the record type,
+    * point and ant. Times are converted from steps using ts.
+    *   CURVE,point,ant,time,mean,var,q05,q25,q50,q75,q95
+    *   FINAL,point,ant,runs,mean,var,q05,q25,q50,q75,q95
+    *   NODE,point,ant,node,prob,mean_time
+    *   REACH,point,ant,fraction,runs_reached,mean_time,var,q05,q25,q50,q75,q95
+    */
+   void write (ostream &out, int point, int ant, double ts) {
+      int i, q;
+      lock_guard<mutex> lock(m_mutex);
+      for (i=0; i<m_rowSteps.size(); ++i) {
+         out << "CURVE," << point << "," << ant << "," << m_rowSteps[i] * ts << ","
+             << m_curve[i].mean << "," << m_curve[i].variance();
+         for (q=0; q<SUMMARY_NUM_QUANTILES; ++q) {
+            out << "," << m_curveSketch[i].quantile(SUMMARY_QUANTILES[q]);
+         }
+         out << "\n";
+      }
+      out << "FINAL," << point << "," << ant << "," << m_runs << "," << m_final.mean << "," << m_final.variance();
+      for (q=0; q<SUMMARY_NUM_QUANTILES; ++q) {
+         out << "," << m_finalSketch.quantile(SUMMARY_QUANTILES[q]);
+      }
+      out << "\n";
+      for (i=0; i<m_nodes; ++i) {
+         out << "NODE," << point << "," << ant << "," << (i+1) << ","
+             << (m_runs > 0 ? (double)m_nodeInfected[i] / m_runs : 0.0) << ","
+             << (m_nodeTime[i].n > 0 ? m_nodeTime[i].mean * ts : -1.0) << "\n";
+      }
+      for (i=0; i<m_fractions.size(); ++i) {
+         out << "REACH," << point << "," << ant << "," << m_fractions[i] << "," << m_reachTime[i].n << ","
+             << (m_reachTime[i].n > 0 ? m_reachTime[i].mean * ts : -1.0) << "," << m_reachTime[i].variance() * ts * ts;
+         for (q=0; q<SUMMARY_NUM_QUANTILES; ++q) {
+            int v = m_reachSketch[i].quantile(SUMMARY_QUANTILES[q]);
+            out << "," << (v >= 0 ? v * ts : -1.0);
+         }
+         out << "\n";
+      }
+   }
+};
+
+/**
+ * Aggregates for a number of outputs (points and ants), each created when
+ * its output gets its first run and freed once it is written, so only
+ * the outputs being run hold statistics. Any thread may get or release.
+ */
+class AggregateSet {
+private:
+   mutex m_mutex;
+   vector<RunAggregate *> m_aggregates;
+   int m_nodes;
+   vector<int> m_rowSteps;
+   vector<double> m_fractions;
+
+public:
+   AggregateSet (int outputs, int nodes, const vector<int> &rowSteps, const vector<double> &fractions) :
+      m_aggregates(outputs, (RunAggregate *)NULL), m_nodes(nodes), m_rowSteps(rowSteps), m_fractions(fractions) { }
+
+   ~AggregateSet () {
+      for (int i=0; i<m_aggregates.size(); ++i) { delete m_aggregates[i]; }
+   }
+
+   int size () const { return m_aggregates.size(); }
+
+   /** The aggregate of an output (created if it has none). */
+   RunAggregate & get (int output) {
+      lock_guard<mutex> lock(m_mutex);
+      if (m_aggregates[output] == NULL) {
+         m_aggregates[output] = new RunAggregate(m_nodes, m_rowSteps, m_fractions);
+      }
+      return *m_aggregates[output];
+   }
+
+   /** Free the aggregate of an output once no more runs will be added. */
+   void release (int output) {
+      lock_guard<mutex> lock(m_mutex);
+      delete m_aggregates[output];
+      m_aggregates[output] = NULL;
+   }
+};
+
+/**
+ * Steps output for a simulation of a given length: every outFreq steps
+ * and the final step.
+ */
+inline vector<int> outputSteps (double simLen, int outFreq) {
+   vector<int> steps;
+   int tEnd = (int)simLen;
+   for (int j=0; j<=tEnd; ++j) {
+      if (j%outFreq == 0 || j == tEnd) {
+         steps.push_back(j);
+      }
+   }
+   return steps;
+}
+
+#endif // DN_AGGREGATE_H
@@ -0,0 +1,160 @@
+/*
+ * analytics.h
+ *
+ * Temporal path statistics of the crossing data, used to choose the ants
+ * to start infected. Infection follows the same rule as the simulations:
+ * a crossing at time t from one node to another can pass infection on if
+ * the first node was infected by the time the other was there (the
+ * crossing's other time) and before t, and only the last crossing of a
+ * pair at a time counts. A single pass over the time ordered contacts
+ * gives the earliest arrival at every node from one source; sources are
+ * independent so they are shared between threads.
+ */
+
+#ifndef DN_ANALYTICS_H
+#define DN_ANALYTICS_H
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <dynamic_nets.h>
+
+using namespace std;
+
+/**
+ * Per node temporal statistics for infection started at tick 0:
+ *  - earliest arrival of infection at every other node,
+ *  - number of nodes reachable,
+ *  - temporal closeness (mean of 1 / arrival time over the other nodes),
+ *  - temporal betweenness (number of source and target pairs whose
+ *    earliest arrival path passes through the node),
+ *  - burstiness of the node's crossings, (sigma - mu) / (sigma + mu) of
+ *    the gaps between them (-1 regular, 0 Poisson, 1 bursty).
+ * Earliest arrival paths are those of the first crossing to reach each
+ * node, so one path is counted per pair. Reads the time ordered contacts,
+ * so DynamicNet::indexByTime() must have been called.
+ */
+class TemporalAnalytics {
+private:
+   const DynamicNet &m_net;
+   int m_size;
+   vector<tick_t> m_arrival;
+   vector<int> m_reach;
+   vector<double> m_closeness;
+   vector<double> m_betweenness;
+   vector<double> m_burstiness;
+
+   /**
+    * Earliest arrival from one source (row of m_arrival), adding the
+    * nodes each node passes infection on to into betweenness.
+    */
+   void sweep (int source, vector<int> &parent, vector<int> &order, vector<int> &below,
+               vector<double> &betweenness) {
+      const vector<Contact> &contacts = m_net.getTimeline();
+      tick_t *arrival = &m_arrival[(size_t)source * m_size];
+      int i, v;
+
+      fill(arrival, arrival + m_size, -1);
+      fill(parent.begin(), parent.end(), -1);
+      arrival[source] = 0;
+      order.clear();
+      for (size_t k = 0; k < contacts.size(); ++k) {
+         const Contact &c = contacts[k];
+         tick_t from = arrival[c.from];
+         // Only the last crossing of a pair at a time counts (as in getTimeSinceUpdate())
+         if (k+1 < contacts.size() && contacts[k+1].time == c.time && contacts[k+1].from == c.from &&
+             contacts[k+1].to == c.to) {
+            continue;
+         }
+         if (from < 0 || from > c.other || from >= c.time || arrival[c.to] >= 0) { continue; }
+         arrival[c.to] = c.time;
+         parent[c.to] = c.from;
+         order.push_back(c.to);
+      }
+
+      // Closeness and reach
+      double closeness = 0.0;
+      for (i = 0; i < m_size; ++i) {
+         if (i != source && arrival[i] > 0) { closeness += 1.0 / (arrival[i] * m_net.getTick()); }
+      }
+      m_reach[source] = order.size();
+      m_closeness[source] = (m_size > 1) ? closeness / (m_size - 1) : 0.0;
+
+      // Nodes below each node in the tree of earliest arrivals (latest first)
+      fill(below.begin(), below.end(), 0);
+      for (i = (int)order.size() - 1; i >= 0; --i) {
+         v = order[i];
+         betweenness[v] += below[v];
+         if (parent[v] != source) { below[parent[v]] += below[v] + 1; }
+      }
+   }
+
+   /** Burstiness of the distinct crossing times of each node. */
+   void computeBurstiness () {
+      const vector<Contact> &contacts = m_net.getTimeline();
+      vector<tick_t> last(m_size, -1);
+      vector<double> sum(m_size, 0.0), sumSq(m_size, 0.0);
+      vector<long> gaps(m_size, 0);
+      for (size_t k = 0; k < contacts.size(); ++k) {
+         const Contact &c = contacts[k];
+         if (c.time == last[c.from]) { continue; }
+         if (last[c.from] >= 0) {
+            double gap = (c.time - last[c.from]) * m_net.getTick();
+            sum[c.from] += gap;
+            sumSq[c.from] += gap * gap;
+            ++gaps[c.from];
+         }
+         last[c.from] = c.time;
+      }
+      for (int i = 0; i < m_size; ++i) {
+         m_burstiness[i] = 0.0;
+         if (gaps[i] < 2) { continue; }
+         double mu = sum[i] / gaps[i];
+         double sigma = sqrt(max(0.0, sumSq[i] / gaps[i] - mu * mu));
+         if (sigma + mu > 0.0) { m_burstiness[i] = (sigma - mu) / (sigma + mu); }
+      }
+   }
+
+public:
+   TemporalAnalytics (const DynamicNet &net) : m_net(net), m_size(net.getSize()),
+      m_arrival((size_t)net.getSize() * net.getSize(), -1), m_reach(net.getSize(), 0),
+      m_closeness(net.getSize(), 0.0), m_betweenness(net.getSize(), 0.0), m_burstiness(net.getSize(), 0.0) { }
+
+   /** Compute every statistic using a number of worker threads. */
+   void run (int threads) {
+      atomic<int> nextSource(0);
+      mutex mergeMutex;
+      vector<thread> workers;
+
+      computeBurstiness();
+      fill(m_betweenness.begin(), m_betweenness.end(), 0.0);
+      for (int t = 0; t < max(1, threads); ++t) {
+         workers.push_back(thread([&]() {
+            vector<int> parent(m_size), order, below(m_size);
+            vector<double> betweenness(m_size, 0.0);
+            int source;
+            while ((source = nextSource.fetch_add(1)) < m_size) {
+               sweep(source, parent, order, below, betweenness);
+            }
+            lock_guard<mutex> lock(mergeMutex);
+            for (int i = 0; i < m_size; ++i) { m_betweenness[i] += betweenness[i]; }
+         }));
+      }
+      for (int t = 0; t < workers.size(); ++t) {
+         workers[t].join();
+      }
+   }
+
+   /** Earliest arrival (in ticks, -1 = never) at a node from a source. */
+   tick_t arrival (int source, int node) const { return m_arrival[(size_t)source * m_size + node]; }
+
+   const vector<int> & reach () const { return m_reach; }
+   const vector<double> & closeness () const { return m_closeness; }
+   const vector<double> & betweenness () const { return m_betweenness; }
+   const vector<double> & burstiness () const { return m_burstiness; }
+};
+
+#endif // DN_ANALYTICS_H
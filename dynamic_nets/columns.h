@@ -0,0 +1,180 @@
+/*
+ * columns.h
+ *
+ * Columnar binary store of the runs, for analysis without parsing text.
+ * Each run is a row and every field is a fixed width column, so a column
+ * such as the infection time of one node over all runs is a contiguous
+ * array once the file is memory mapped. Rows are placed by (point, ant,
+ * run), so the file is sized up front and worker threads write their
+ * rows straight into the mapping.
+ *
+ * All values are in the host's byte order.
+ *
+ * File:
+ *   char   magic[4]     "DNT1"
+ *   uint32 nodes
+ *   uint64 rows
+ *   columns, each rows values long (padded to 8 bytes):
+ *     uint32 point, ant, run            (each from 1)
+ *     uint32 final                      (infected at the end of the run)
+ *     double time                       (time of the run's last state)
+ *     double infection[nodes]           (time each node, in the data's order,
+ *                                        was infected; -1 if never)
+ */
+
+#ifndef DN_COLUMNS_H
+#define DN_COLUMNS_H
+
+#include <stdint.h>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+static const char COLUMNS_MAGIC[4] = { 'D', 'N', 'T', '1' };
+
+/**
+ * Offsets of the columns in a store of a given size.
+ */
+struct ColumnLayout {
+   uint64_t point, ant, run, final, time, infection, size;
+
+   ColumnLayout (uint32_t nodes, uint64_t rows) {
+      uint64_t ints = (rows * sizeof(uint32_t) + 7) & ~(uint64_t)7;
+      point = 16;
+      ant = point + ints;
+      run = ant + ints;
+      final = run + ints;
+      time = final + ints;
+      infection = time + rows * sizeof(double);
+      size = infection + (uint64_t)nodes * rows * sizeof(double);
+   }
+};
+
+/**
+ * Writes a store with a fixed number of rows. Rows may be written in any
+ * order and from any number of threads as long as each row is written by
+ * only one.
+ */
+class ColumnWriter {
+private:
+   int m_fd;
+   char *m_data;
+   uint32_t m_nodes;
+   uint64_t m_rows;
+   ColumnLayout m_layout;
+
+public:
+   /** Create (or replace) a store. Check isOpen() before use. */
+   ColumnWriter (const string &filename, uint32_t nodes, uint64_t rows) : m_data(NULL), m_nodes(nodes),
+      m_rows(rows), m_layout(nodes, rows) {
+      m_fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+      if (m_fd >= 0 && ::ftruncate(m_fd, m_layout.size) == 0) {
+         void *p = ::mmap(NULL, m_layout.size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+         if (p != MAP_FAILED) { m_data = (char *)p; }
+      }
+      if (m_data == NULL) {
+         cerr << "Error: could not create " << filename << " (" << strerror(errno) << ")." << endl;
+         return;
+      }
+      memcpy(m_data, COLUMNS_MAGIC, sizeof(COLUMNS_MAGIC));
+      memcpy(m_data + 4, &m_nodes, sizeof(m_nodes));
+      memcpy(m_data + 8, &m_rows, sizeof(m_rows));
+   }
+
+   ~ColumnWriter () { close(); }
+
+   bool isOpen () const { return m_data != NULL; }
+
+   /**
+    * Write a row. infectedStep holds the step each node was infected at
+    * (-1 if never), converted to times with the length of a step ts.
+    */
+   void write (uint64_t row, uint32_t point, uint32_t ant, uint32_t run, uint32_t final, double time,
+               const vector<int> &infectedStep, double ts) {
+      ((uint32_t *)(m_data + m_layout.point))[row] = point;
+      ((uint32_t *)(m_data + m_layout.ant))[row] = ant;
+      ((uint32_t *)(m_data + m_layout.run))[row] = run;
+      ((uint32_t *)(m_data + m_layout.final))[row] = final;
+      ((double *)(m_data + m_layout.time))[row] = time;
+      double *infection = (double *)(m_data + m_layout.infection);
+      for (uint32_t i = 0; i < m_nodes; ++i) {
+         infection[i * m_rows + row] = (infectedStep[i] >= 0) ? infectedStep[i] * ts : -1.0;
+      }
+   }
+
+   /** Flush and close the store. Returns false if it could not be written. */
+   bool close () {
+      bool ok = true;
+      if (m_data != NULL) {
+         ok = (::msync(m_data, m_layout.size, MS_SYNC) == 0);
+         ::munmap(m_data, m_layout.size);
+         m_data = NULL;
+      }
+      if (m_fd >= 0) {
+         ::close(m_fd);
+         m_fd = -1;
+      }
+      return ok;
+   }
+};
+
+/**
+ * Read-only view of a store through a memory mapping. Columns are
+ * returned as arrays of rows() values.
+ */
+class ColumnStore {
+private:
+   const char *m_data;
+   size_t m_size;
+   uint32_t m_nodes;
+   uint64_t m_rows;
+   ColumnLayout m_layout;
+
+public:
+   ColumnStore () : m_data(NULL), m_size(0), m_nodes(0), m_rows(0), m_layout(0, 0) { }
+   ~ColumnStore () { if (m_data != NULL) { ::munmap((void *)m_data, m_size); } }
+
+   /** Map a store. Returns false if it is not a complete store. */
+   bool open (const string &filename) {
+      struct stat st;
+      int fd = ::open(filename.c_str(), O_RDONLY);
+      if (fd < 0) { return false; }
+      if (::fstat(fd, &st) != 0 || st.st_size < 16) {
+         ::close(fd);
+         return false;
+      }
+      void *p = ::mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      ::close(fd);
+      if (p == MAP_FAILED) { return false; }
+      m_data = (const char *)p;
+      m_size = st.st_size;
+      memcpy(&m_nodes, m_data + 4, sizeof(m_nodes));
+      memcpy(&m_rows, m_data + 8, sizeof(m_rows));
+      m_layout = ColumnLayout(m_nodes, m_rows);
+      return memcmp(m_data, COLUMNS_MAGIC, sizeof(COLUMNS_MAGIC)) == 0 && m_layout.size == m_size;
+   }
+
+   uint32_t nodes () const { return m_nodes; }
+   uint64_t rows () const { return m_rows; }
+
+   const uint32_t * point () const { return (const uint32_t *)(m_data + m_layout.point); }
+   const uint32_t * ant () const { return (const uint32_t *)(m_data + m_layout.ant); }
+   const uint32_t * run () const { return (const uint32_t *)(m_data + m_layout.run); }
+   const uint32_t * finalSize () const { return (const uint32_t *)(m_data + m_layout.final); }
+   const double * time () const { return (const double *)(m_data + m_layout.time); }
+
+   /** Infection time of a node (from 0, in the data's order) in every run. */
+   const double * infection (uint32_t node) const {
+      return (const double *)(m_data + m_layout.infection) + (uint64_t)node * m_rows;
+   }
+};
+
+#endif // DN_COLUMNS_H
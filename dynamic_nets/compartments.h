@@ -0,0 +1,324 @@
+/*
+ * compartments.h
+ *
+ * Generic compartmental spreading models (SI, SIS, SIR, SEIR) over the
+ * crossing data. A model is a small table: which compartments there are,
+ * which are infectious, where a susceptible node goes on infection and
+ * which compartments are left after a delay. Nodes hold a single byte for
+ * their compartment and delayed transitions are kept in one event queue
+ * per compartment, so a step only touches the contacts occurring at that
+ * time and the transitions that are due. Other interaction rules are
+ * asked about every infectious and susceptible pair instead.
+ */
+
+#ifndef DN_COMPARTMENTS_H
+#define DN_COMPARTMENTS_H
+
+#include <cmath>
+#include <vector>
+#include <queue>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <dynamic_nets.h>
+#include <interactions.h>
+#include <netevo.h>
+
+using namespace std;
+using namespace netevo;
+
+/**
+ * Compartment codes. These are the values written to the output so the
+ * codes are fixed across models (0 and 1 keep their SI meaning).
+ */
+enum compartment_e {
+   COMP_S = 0,
+   COMP_I = 1,
+   COMP_R = 2,
+   COMP_E = 3,
+   COMP_COUNT = 4
+};
+
+/**
+ * A delayed transition: nodes leave a compartment for another after a
+ * delay with the given mean, either fixed or exponentially distributed.
+ */
+struct DelayedTransition {
+   bool active;
+   unsigned char to;
+   double mean;
+   bool exponential;
+};
+
+/**
+ * Table describing a compartmental model.
+ */
+class CompartmentModel {
+public:
+   string name;
+   /** Whether each compartment can pass on infection. */
+   bool infectious[COMP_COUNT];
+   /** Compartment a susceptible node enters when infected. */
+   unsigned char onInfection;
+   /** Delayed transition out of each compartment (if any). */
+   DelayedTransition delayed[COMP_COUNT];
+
+   CompartmentModel () : name("SI"), onInfection(COMP_I) {
+      for (int c=0; c<COMP_COUNT; ++c) {
+         infectious[c] = false;
+         delayed[c].active = false;
+         delayed[c].to = c;
+         delayed[c].mean = 0.0;
+         delayed[c].exponential = true;
+      }
+      infectious[COMP_I] = true;
+   }
+
+   /** Add a delayed transition. */
+   void addDelay (unsigned char from, unsigned char to, double mean, bool exponential) {
+      delayed[from].active = true;
+      delayed[from].to = to;
+      delayed[from].mean = mean;
+      delayed[from].exponential = exponential;
+   }
+
+   /**
+    * Build one of the standard models by name (SI, SIS, SIR or SEIR).
+    * Delays are in the same time units as the data. Returns false if the
+    * name is not recognised.
+    */
+   bool byName (const string &model, double latency, double recovery, bool exponential) {
+      *this = CompartmentModel();
+      name = model;
+      if (model == "SI") {
+         return true;
+      }
+      if (model == "SIS") {
+         addDelay(COMP_I, COMP_S, recovery, exponential);
+         return true;
+      }
+      if (model == "SIR") {
+         addDelay(COMP_I, COMP_R, recovery, exponential);
+         return true;
+      }
+      if (model == "SEIR") {
+         onInfection = COMP_E;
+         addDelay(COMP_E, COMP_I, latency, exponential);
+         addDelay(COMP_I, COMP_R, recovery, exponential);
+         return true;
+      }
+      return false;
+   }
+};
+
+/**
+ * Discrete time simulator for a CompartmentModel.
+ * Uses the same contact rule as SIMap: at step t a contact whose crossing
+ * happens at tick TIMESTEP * t (in ticks) passes on infection with probability
+ * SI_PROB * calcWeight(delay, DECAY_RATE), provided the infecting node
+ * was infectious by the time the other node was there. Only the last
+ * crossing of a pair at a given time counts. Contacts are read from the
+ * time ordered list, so DynamicNet::indexByTime() must have been called.
+ * If another Interaction is set it gives the weight of each infectious and
+ * susceptible pair at every step, as in SIMap.
+ * The state holds the compartment code of each node.
+ */
+class SimulateCompartments : public Simulate {
+private:
+   /** A pending delayed transition (time in ticks). */
+   struct Event {
+      double time;
+      int node;
+      unsigned int stamp;
+      bool operator> (const Event &e) const { return time > e.time; }
+   };
+   typedef priority_queue<Event, vector<Event>, greater<Event> > EventQueue;
+
+   const DynamicNet &m_net;
+   /** Rule for the contacts (NULL = delayed crossings from the time ordered list). */
+   const Interaction *m_interaction;
+   CompartmentModel m_model;
+   double m_probSI;
+   double m_decayRate;
+   /** Length of a timestep in ticks. */
+   tick_t m_ts;
+   bool m_earlyStop;
+
+   /** Compartment of each node. */
+   vector<unsigned char> m_comp;
+   /** Tick each node last became infectious at (-1 = not infectious). */
+   vector<tick_t> m_infectiousSince;
+   /** Incremented on every change so stale events can be ignored. */
+   vector<unsigned int> m_stamp;
+   /** Delayed transitions waiting in each compartment. */
+   vector<EventQueue> m_queues;
+   /** Nodes infected during the current step (and a flag for each node). */
+   vector<int> m_newInfections;
+   vector<unsigned char> m_infectedNow;
+   unsigned long m_contacts;
+
+   /** Move a node to a compartment at a given tick, scheduling any delayed transition. */
+   void enter (System &sys, int node, unsigned char c, tick_t t, State &x) {
+      m_comp[node] = c;
+      x[node] = (double)c;
+      ++m_stamp[node];
+      m_infectiousSince[node] = m_model.infectious[c] ? t : -1;
+      const DelayedTransition &d = m_model.delayed[c];
+      if (d.active) {
+         Event e;
+         double mean = d.mean / m_net.getTick();
+         e.time = t + (d.exponential ? -mean * log(1.0 - sys.rnd()) : mean);
+         e.node = node;
+         e.stamp = m_stamp[node];
+         m_queues[c].push(e);
+      }
+   }
+
+   void observe (System &sys, const State &x, double t, SimObserver &obs, ChangeLog &logger) {
+      logger.newState(sys, x);
+      logger.endStep(SIM_STEP);
+      logger.commit();
+      obs(x, t);
+   }
+
+   /** True once nothing can change after tick tt. */
+   bool absorbed (tick_t tt) const {
+      int c;
+      for (c=0; c<COMP_COUNT; ++c) {
+         if (!m_queues[c].empty()) { return false; }
+      }
+      tick_t h = m_net.getHorizon([&](int i) { return m_model.infectious[m_comp[i]]; },
+                                  [&](int j) { return m_comp[j] == COMP_S; });
+      return (tt >= h);
+   }
+
+   /**
+    * Infection over the time ordered contacts at tick tt, moving the cursor
+    * past them. Crossings that do not fall on a step are never evaluated.
+    */
+   void infectContacts (System &sys, const vector<Contact> &contacts, size_t &cursor, tick_t tt) {
+      while (cursor < contacts.size() && contacts[cursor].time < tt) { ++cursor; }
+      for (; cursor < contacts.size() && contacts[cursor].time == tt; ++cursor) {
+         const Contact &k = contacts[cursor];
+         // Only the last crossing of a pair at a time counts
+         if (cursor+1 < contacts.size() && contacts[cursor+1].time == tt &&
+             contacts[cursor+1].from == k.from && contacts[cursor+1].to == k.to) {
+            continue;
+         }
+         if (m_comp[k.to] != COMP_S || m_infectedNow[k.to] || !m_model.infectious[m_comp[k.from]]) { continue; }
+         ++m_contacts;
+         if (m_infectiousSince[k.from] <= k.other &&
+             sys.rnd() <= m_probSI * calcWeight((k.time - k.other) * m_net.getTick(), m_decayRate)) {
+            m_infectedNow[k.to] = 1;
+            m_newInfections.push_back(k.to);
+         }
+      }
+   }
+
+   /** Infection over every infectious and susceptible pair in the step starting at tick tt. */
+   void infectPairs (System &sys, tick_t tt) {
+      int i, j, crossing, n = m_net.getSize();
+      double weight;
+      for (j=0; j<n; ++j) {
+         if (m_comp[j] != COMP_S) { continue; }
+         for (i=0; i<n; ++i) {
+            if (i == j || !m_model.infectious[m_comp[i]]) { continue; }
+            ++m_contacts;
+            weight = m_interaction->weight(m_net, i, j, tt, m_ts, m_decayRate, m_infectiousSince[i], crossing);
+            if (weight != -1.0 && sys.rnd() <= m_probSI * weight) {
+               m_newInfections.push_back(j);
+               break;
+            }
+         }
+      }
+   }
+
+public:
+   SimulateCompartments (const DynamicNet &net) : m_net(net), m_interaction(NULL), m_probSI(0.0),
+      m_decayRate(0.0), m_ts(1), m_earlyStop(false), m_comp(net.getSize(), COMP_S), m_infectiousSince(net.getSize(), -1),
+      m_stamp(net.getSize(), 0), m_queues(COMP_COUNT), m_infectedNow(net.getSize(), 0), m_contacts(0) { }
+
+   /**
+    * Set the interaction rule. Delayed crossings (or NULL) use the time
+    * ordered list, which only touches the contacts at each step.
+    */
+   void setInteraction (const Interaction *interaction) {
+      m_interaction = (dynamic_cast<const DelayedCrossing *>(interaction) != NULL) ? NULL : interaction;
+   }
+
+   /** Set the model to simulate. */
+   void setModel (const CompartmentModel &model) { m_model = model; }
+
+   /** Set the infection parameters and length of a timestep (a whole number of ticks). */
+   void setParams (double probSI, double decayRate, double ts) {
+      m_probSI = probSI;
+      m_decayRate = decayRate;
+      m_ts = m_net.stepTicks(ts);
+   }
+
+   /** Stop once nothing can change (the final state is observed once). */
+   void setEarlyStop (bool earlyStop) { m_earlyStop = earlyStop; }
+
+   /** Running count of contacts evaluated (used for telemetry). */
+   const unsigned long & contactsEvaluated () { return m_contacts; }
+
+   /**
+    * Simulate from the initial compartments (nodes at 1.0 start infected).
+    * Nodes starting in an infectious compartment are infectious from time 0.
+    */
+   void simulate (System &sys, double tMax, State &initial, SimObserver &obs, ChangeLog &logger) {
+      const vector<Contact> &contacts = m_net.getTimeline();
+      int i, c, t, tEnd = (int)tMax, n = m_net.getSize();
+      State &x = initial;
+      size_t cursor = 0;
+
+      if (initial.size() != n) {
+         cerr << "Incorrect number of states for initial conditions (SimulateCompartments::simulate)" << endl;
+         return;
+      }
+
+      // Set up the initial compartments
+      for (c=0; c<COMP_COUNT; ++c) {
+         m_queues[c] = EventQueue();
+      }
+      for (i=0; i<n; ++i) {
+         enter(sys, i, (unsigned char)x[i], 0, x);
+      }
+      observe(sys, x, 0.0, obs, logger);
+      if (m_earlyStop && absorbed(0)) { return; }
+
+      for (t=1; t<=tEnd; ++t) {
+         tick_t tt = m_ts * t;
+
+         // Infection using the state at the start of the step
+         m_newInfections.clear();
+         if (m_interaction != NULL) {
+            infectPairs(sys, tt);
+         }
+         else {
+            infectContacts(sys, contacts, cursor, tt);
+         }
+         for (i=0; i<m_newInfections.size(); ++i) {
+            m_infectedNow[m_newInfections[i]] = 0;
+            enter(sys, m_newInfections[i], m_model.onInfection, tt, x);
+         }
+
+         // Delayed transitions that are due
+         for (c=0; c<COMP_COUNT; ++c) {
+            EventQueue &q = m_queues[c];
+            while (!q.empty() && q.top().time <= tt) {
+               Event e = q.top();
+               q.pop();
+               if (e.stamp == m_stamp[e.node] && m_comp[e.node] == c) {
+                  enter(sys, e.node, m_model.delayed[c].to, tt, x);
+               }
+            }
+         }
+
+         observe(sys, x, (double)t, obs, logger);
+         if (m_earlyStop && absorbed(tt)) { break; }
+      }
+   }
+};
+
+#endif // DN_COMPARTMENTS_H
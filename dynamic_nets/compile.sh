@@ -1,6 +1,39 @@
 #!/bin/bash
 
 # PATH TO HEADER FILES
-CXXFLAGS="-I ../lib/netevo/ -I ../lib/include -I /Users/Tom/Development/Library/include -I ."
+CXXFLAGS="-I ../lib/netevo/ -I ../lib/include -I /Users/Tom/Development/Library/include -I . -O3 -std=c++11 -pthread"
 
-g++ $CXXFLAGS ../lib/netevo/gml.cc ../lib/netevo/simulate.cc ../lib/netevo/system.cc dynamic_nets.cc -o dynNet -O3 
+# NETEVO LIBRARY (THE ENGINE ITSELF IS HEADER ONLY)
+for SRC in evolve gml simulate system; do
+   g++ $CXXFLAGS -c ../lib/netevo/$SRC.cc -o $SRC.o
+done
+ar rcs libdynnet.a evolve.o gml.o simulate.o system.o
+rm -f evolve.o gml.o simulate.o system.o
+
+# CHECKS, EACH PRINTS ok OR THE FIRST PROBLEM FOUND
+#   mutate      NETEVO'S RANDOM MUTATIONS ARE LOGGED CONSISTENTLY
+#   container   RUNS WRITTEN TO A CONTAINER READ BACK UNCHANGED
+#   columns     ROWS WRITTEN TO A COLUMNAR STORE READ BACK UNCHANGED
+#   compressed  COMPRESSED CROSSINGS ANSWER LOOKUPS AS THE PLAIN ONES
+#   aggregate   ONLINE STATISTICS, SKETCHES AND MERGED AGGREGATES ARE EXACT
+#   gillespie   THE CONTINUOUS-TIME ENGINE INFECTS WITH THE EXPECTED PROBABILITY
+#   compartments  SI, SEIR AND OTHER INTERACTION RULES SPREAD AS EXPECTED
+#   relabel     RELABELLED NETWORKS ANSWER LOOKUPS BY ORIGINAL NODE AS BEFORE
+#   server      REQUESTS AND RESPONSES OF THE SERVER PROTOCOL DECODE UNCHANGED
+#   sweep       PARAMETER LISTS, RANGES AND GRIDS PARSE AND RUNS WRITE IN ORDER
+for CHECK in mutate container columns compressed aggregate gillespie compartments relabel server sweep; do
+   printf "check_%s: " $CHECK
+   g++ $CXXFLAGS test/check_$CHECK.cc -L . -ldynnet -o test/check_$CHECK && (cd test && ./check_$CHECK)
+done
+
+# DRIVER (DELAYED CROSSINGS BY DEFAULT, --direct FOR DIRECT INTERACTIONS)
+g++ $CXXFLAGS dynamic_nets.cc -L . -ldynnet -o dynNet
+
+# CHECKS OF WHOLE RUNS OF THE DRIVER (SEE test/check_runs.sh)
+printf "check_runs: "
+bash test/check_runs.sh
+
+# DISTRIBUTED DRIVER (RUN WITH mpirun -np N dynNetMPI ...)
+if command -v mpicxx > /dev/null; then
+   mpicxx $CXXFLAGS -DDN_MPI dynamic_nets.cc -L . -ldynnet -o dynNetMPI
+fi
@@ -0,0 +1,180 @@
+/*
+ * compressed.h
+ *
+ * Compact storage for the crossings of every edge. Consecutive crossings
+ * of an edge are close in time, so each edge's list is cut into blocks of
+ * CROSSING_BLOCK crossings and stored as variable length deltas. A skip
+ * index holds the first time and byte offset of every block, so a lookup
+ * binary searches the blocks and decodes only the one it needs.
+ */
+
+#ifndef DN_COMPRESSED_H
+#define DN_COMPRESSED_H
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+/** Crossings per block. */
+static const int CROSSING_BLOCK = 64;
+
+/**
+ * Read-only compressed crossing lists for a fixed number of edges.
+ * Each crossing is (time, other time) in ticks, with lists sorted by
+ * time. Within a block a crossing is stored as two varints: the gap from
+ * the previous crossing's time (the first is in the skip index) and the
+ * zigzag encoded delay from the other time to the crossing time.
+ */
+template <class Tick>
+class CompressedCrossings {
+private:
+   vector<uint8_t> m_data;
+   /** First time and byte offset of each block. */
+   vector<Tick> m_blockFirst;
+   vector<uint64_t> m_blockOffset;
+   /** First block and number of crossings of each edge. */
+   vector<uint32_t> m_edgeBlock;
+   vector<uint32_t> m_edgeCount;
+
+   void putVarint (uint64_t v) {
+      while (v >= 0x80) {
+         m_data.push_back((uint8_t)(v | 0x80));
+         v >>= 7;
+      }
+      m_data.push_back((uint8_t)v);
+   }
+
+   static uint64_t getVarint (const uint8_t *&p) {
+      uint64_t v = 0;
+      int shift = 0;
+      while (*p & 0x80) {
+         v |= (uint64_t)(*p++ & 0x7f) << shift;
+         shift += 7;
+      }
+      v |= (uint64_t)(*p++) << shift;
+      return v;
+   }
+
+   static uint64_t zigzag (int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+   static int64_t unzigzag (uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+public:
+   /**
+    * Decodes the crossings of one edge in order, starting from any block.
+    */
+   class Cursor {
+   private:
+      const CompressedCrossings &m_store;
+      const uint8_t *m_p;
+      uint32_t m_block;
+      uint32_t m_lastBlock;
+      int m_index;
+      int m_count;
+      int m_inBlock;
+      Tick m_time;
+   public:
+      Cursor (const CompressedCrossings &store, int edge) : m_store(store), m_p(NULL), m_index(0) {
+         m_block = store.m_edgeBlock[edge];
+         m_lastBlock = store.m_edgeBlock[edge+1];
+         m_count = store.m_edgeCount[edge];
+         m_inBlock = CROSSING_BLOCK;
+      }
+
+      /** Position at the start of a block (relative to the edge). */
+      void seekBlock (int block) {
+         m_block += block;
+         m_index = block * CROSSING_BLOCK;
+         m_inBlock = CROSSING_BLOCK;
+      }
+
+      /** Index (in the edge's list) of the crossing next() will return. */
+      int index () const { return m_index; }
+
+      /** Decode the next crossing. Returns false at the end of the list. */
+      bool next (Tick &time, Tick &other) {
+         if (m_index >= m_count) { return false; }
+         if (m_inBlock == CROSSING_BLOCK) {
+            m_p = &m_store.m_data[m_store.m_blockOffset[m_block]];
+            m_time = m_store.m_blockFirst[m_block];
+            ++m_block;
+            m_inBlock = 0;
+         }
+         m_time += (Tick)getVarint(m_p);
+         time = m_time;
+         other = (Tick)(m_time - unzigzag(getVarint(m_p)));
+         ++m_inBlock;
+         ++m_index;
+         return true;
+      }
+   };
+
+   /**
+    * Build from sorted crossing lists, one per edge.
+    */
+   template <class Pair>
+   CompressedCrossings (const vector< vector<Pair> > &edges) {
+      m_edgeBlock.reserve(edges.size() + 1);
+      m_edgeCount.reserve(edges.size());
+      for (size_t e = 0; e < edges.size(); ++e) {
+         const vector<Pair> &crossings = edges[e];
+         m_edgeBlock.push_back(m_blockFirst.size());
+         m_edgeCount.push_back(crossings.size());
+         Tick prev = 0;
+         for (size_t k = 0; k < crossings.size(); ++k) {
+            if (k % CROSSING_BLOCK == 0) {
+               m_blockFirst.push_back(crossings[k].first);
+               m_blockOffset.push_back(m_data.size());
+               prev = crossings[k].first;
+            }
+            putVarint((uint64_t)(crossings[k].first - prev));
+            putVarint(zigzag((int64_t)crossings[k].first - crossings[k].second));
+            prev = crossings[k].first;
+         }
+      }
+      m_edgeBlock.push_back(m_blockFirst.size());
+      m_data.shrink_to_fit();
+   }
+
+   /** Number of crossings of an edge. */
+   int size (int edge) const { return m_edgeCount[edge]; }
+
+   /** Bytes used (data and indexes). */
+   size_t bytes () const {
+      return m_data.size() + m_blockFirst.size() * (sizeof(Tick) + sizeof(uint64_t)) +
+             (m_edgeBlock.size() + m_edgeCount.size()) * sizeof(uint32_t);
+   }
+
+   /** Cursor over an edge's crossings, starting at the first. */
+   Cursor cursor (int edge) const { return Cursor(*this, edge); }
+
+   /**
+    * Cursor positioned at the block holding the last crossing at or before
+    * t (or the first block if there is none).
+    */
+   Cursor seekAtOrBefore (int edge, Tick t) const {
+      Cursor c(*this, edge);
+      typename vector<Tick>::const_iterator first = m_blockFirst.begin() + m_edgeBlock[edge];
+      typename vector<Tick>::const_iterator last = m_blockFirst.begin() + m_edgeBlock[edge+1];
+      int block = (int)(upper_bound(first, last, t) - first) - 1;
+      if (block > 0) { c.seekBlock(block); }
+      return c;
+   }
+
+   /**
+    * Cursor positioned at the block holding the first crossing at or after
+    * t (any earlier crossings in the block are decoded first).
+    */
+   Cursor seekAtOrAfter (int edge, Tick t) const {
+      Cursor c(*this, edge);
+      typename vector<Tick>::const_iterator first = m_blockFirst.begin() + m_edgeBlock[edge];
+      typename vector<Tick>::const_iterator last = m_blockFirst.begin() + m_edgeBlock[edge+1];
+      // The block before the first starting at or after t may still end after it
+      int block = (int)(lower_bound(first, last, t) - first) - 1;
+      if (block > 0) { c.seekBlock(block); }
+      return c;
+   }
+};
+
+#endif // DN_COMPRESSED_H
@@ -0,0 +1,199 @@
+/*
+ * container.h
+ *
+ * Single file output for the runs of every point and ant, in place of a
+ * text file per ant. Runs are appended as they complete (from any thread)
+ * and an index by (point, ant, run) is written as a footer once all runs
+ * are done, so any run can be read back directly.
+ *
+ * All values are in the host's byte order.
+ *
+ * File:
+ *   char   magic[4]     "DNC1"
+ *   records             the formatted output of each run (as in the
+ *                       text files), in the order the runs completed
+ *   index entries:
+ *     uint32 point, ant, run, reserved   (each from 1)
+ *     uint64 offset, length              (of the record)
+ *   uint64 index offset, entries
+ *   char   magic[4]     "DNCI"
+ */
+
+#ifndef DN_CONTAINER_H
+#define DN_CONTAINER_H
+
+#include <stdint.h>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const char CONTAINER_MAGIC[4] = { 'D', 'N', 'C', '1' };
+static const char CONTAINER_INDEX_MAGIC[4] = { 'D', 'N', 'C', 'I' };
+
+/**
+ * Index entry of a single run.
+ */
+struct ContainerEntry {
+   uint32_t point;
+   uint32_t ant;
+   uint32_t run;
+   uint32_t reserved;
+   uint64_t offset;
+   uint64_t length;
+};
+
+/**
+ * Writes a container. Space for each record is reserved by advancing the
+ * end of the file atomically and the record is then written with pwrite,
+ * so threads append without waiting on each other; only the index entry
+ * is added under a lock.
+ */
+class ContainerWriter {
+private:
+   int m_fd;
+   atomic<uint64_t> m_end;
+   mutex m_mutex;
+   vector<ContainerEntry> m_index;
+   bool m_failed;
+
+   bool writeAt (const char *p, size_t len, uint64_t offset) {
+      while (len > 0) {
+         ssize_t n = ::pwrite(m_fd, p, len, offset);
+         if (n < 0 && errno == EINTR) { continue; }
+         if (n <= 0) { return false; }
+         p += n;
+         len -= n;
+         offset += n;
+      }
+      return true;
+   }
+
+public:
+   /** Create (or replace) a container. Check isOpen() before use. */
+   ContainerWriter (const string &filename) : m_end(0), m_failed(false) {
+      m_fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (m_fd < 0) {
+         cerr << "Error: could not create " << filename << " (" << strerror(errno) << ")." << endl;
+         return;
+      }
+      m_failed = !writeAt(CONTAINER_MAGIC, sizeof(CONTAINER_MAGIC), 0);
+      m_end = sizeof(CONTAINER_MAGIC);
+   }
+
+   ~ContainerWriter () { close(); }
+
+   bool isOpen () const { return m_fd >= 0; }
+
+   /** Append the formatted output of a run (point, ant and run from 1). */
+   void append (int point, int ant, int run, const string &data) {
+      ContainerEntry e;
+      e.point = point;
+      e.ant = ant;
+      e.run = run;
+      e.reserved = 0;
+      e.length = data.size();
+      e.offset = m_end.fetch_add(e.length);
+      bool ok = writeAt(data.data(), data.size(), e.offset);
+      lock_guard<mutex> lock(m_mutex);
+      m_index.push_back(e);
+      if (!ok) { m_failed = true; }
+   }
+
+   /** Write the index and close the file. Returns false if any write failed. */
+   bool close () {
+      if (m_fd < 0) { return !m_failed; }
+      uint64_t indexOffset = m_end;
+      uint64_t entries = m_index.size();
+      string footer;
+      if (!m_index.empty()) { footer.append((const char *)&m_index[0], m_index.size() * sizeof(ContainerEntry)); }
+      footer.append((const char *)&indexOffset, sizeof(indexOffset));
+      footer.append((const char *)&entries, sizeof(entries));
+      footer.append(CONTAINER_INDEX_MAGIC, sizeof(CONTAINER_INDEX_MAGIC));
+      if (!writeAt(footer.data(), footer.size(), indexOffset)) { m_failed = true; }
+      ::close(m_fd);
+      m_fd = -1;
+      if (m_failed) { cerr << "Error: could not write every run to the container." << endl; }
+      return !m_failed;
+   }
+};
+
+/**
+ * Reads runs back from a container by (point, ant, run).
+ */
+class ContainerReader {
+private:
+   int m_fd;
+   vector<ContainerEntry> m_index;
+   map< pair<uint64_t, uint32_t>, size_t > m_lookup;
+
+   static pair<uint64_t, uint32_t> key (uint32_t point, uint32_t ant, uint32_t run) {
+      return make_pair(((uint64_t)point << 32) | ant, run);
+   }
+
+   bool readAt (char *p, size_t len, uint64_t offset) const {
+      while (len > 0) {
+         ssize_t n = ::pread(m_fd, p, len, offset);
+         if (n < 0 && errno == EINTR) { continue; }
+         if (n <= 0) { return false; }
+         p += n;
+         len -= n;
+         offset += n;
+      }
+      return true;
+   }
+
+public:
+   ContainerReader () : m_fd(-1) { }
+   ~ContainerReader () { if (m_fd >= 0) { ::close(m_fd); } }
+
+   /** Open a container and load its index. Returns false if it is not a complete container. */
+   bool open (const string &filename) {
+      char magic[4];
+      uint64_t trailer[2];
+      m_fd = ::open(filename.c_str(), O_RDONLY);
+      if (m_fd < 0) { return false; }
+      off_t size = ::lseek(m_fd, 0, SEEK_END);
+      if (size < (off_t)(sizeof(CONTAINER_MAGIC) + sizeof(trailer) + sizeof(magic)) ||
+          !readAt(magic, sizeof(magic), 0) || memcmp(magic, CONTAINER_MAGIC, sizeof(magic)) != 0 ||
+          !readAt(magic, sizeof(magic), size - sizeof(magic)) || memcmp(magic, CONTAINER_INDEX_MAGIC, sizeof(magic)) != 0 ||
+          !readAt((char *)trailer, sizeof(trailer), size - sizeof(magic) - sizeof(trailer))) {
+         return false;
+      }
+      if (trailer[0] + trailer[1] * sizeof(ContainerEntry) + sizeof(trailer) + sizeof(magic) != (uint64_t)size) {
+         return false;
+      }
+      m_index.resize(trailer[1]);
+      if (!m_index.empty() && !readAt((char *)&m_index[0], m_index.size() * sizeof(ContainerEntry), trailer[0])) {
+         return false;
+      }
+      for (size_t i = 0; i < m_index.size(); ++i) {
+         m_lookup[key(m_index[i].point, m_index[i].ant, m_index[i].run)] = i;
+      }
+      return true;
+   }
+
+   /** Every run in the container (in the order written). */
+   const vector<ContainerEntry> & entries () const { return m_index; }
+
+   /** Read a run's output. Returns false if the run is not in the container. */
+   bool read (int point, int ant, int run, string &data) const {
+      map< pair<uint64_t, uint32_t>, size_t >::const_iterator itr = m_lookup.find(key(point, ant, run));
+      if (itr == m_lookup.end()) { return false; }
+      return read(m_index[itr->second], data);
+   }
+   bool read (const ContainerEntry &e, string &data) const {
+      data.resize(e.length);
+      return e.length == 0 || readAt(&data[0], e.length, e.offset);
+   }
+};
+
+#endif // DN_CONTAINER_H
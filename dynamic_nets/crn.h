@@ -0,0 +1,39 @@
+/*
+ * crn.h
+ *
+ * Common random numbers for variance reduction across parameter sweeps.
+ * Instead of drawing from a generator, each random decision is given a
+ * fixed uniform value that depends only on what is being decided. Runs at
+ * neighbouring parameter points then see the same draws and differences
+ * between them are due to the parameters rather than sampling noise.
+ */
+
+#ifndef DN_CRN_H
+#define DN_CRN_H
+
+#include <stdint.h>
+
+/** SplitMix64 finaliser; a fast, well mixed 64-bit bijection. */
+inline uint64_t crnMix (uint64_t z) {
+   z += 0x9e3779b97f4a7c15ULL;
+   z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+   z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+   return z ^ (z >> 31);
+}
+
+/**
+ * Uniform draw in [0, 1) for a contact event.
+ * The value is a function of the seed, the run (seed ant and run number),
+ * the susceptible node, the infected node and the index of the crossing
+ * between them, so the same event always receives the same draw.
+ */
+inline double crnUniform (uint64_t seed, int ant, int run, int node, int other, int crossing) {
+   uint64_t h = crnMix(seed);
+   h = crnMix(h ^ (((uint64_t)(uint32_t)ant << 32) | (uint32_t)run));
+   h = crnMix(h ^ (((uint64_t)(uint32_t)node << 32) | (uint32_t)other));
+   h = crnMix(h ^ (uint64_t)(uint32_t)crossing);
+   // Use the top 53 bits to fill a double mantissa
+   return (h >> 11) * (1.0 / 9007199254740992.0);
+}
+
+#endif // DN_CRN_H
@@ -0,0 +1,116 @@
+/*
+ * distributed.h
+ *
+ * Distributing runs over MPI processes. Rank 0 reads the data and sends
+ * it to every other rank once, then acts as a coordinator: each worker
+ * asks for a task when it is free (returning the result of its previous
+ * one) so faster or less loaded ranks simply take on more of the work.
+ * Results are packed as flat arrays of doubles.
+ */
+
+#ifndef DN_DISTRIBUTED_H
+#define DN_DISTRIBUTED_H
+
+#include <mpi.h>
+#include <vector>
+#include <dynamic_nets.h>
+
+using namespace std;
+
+/** Message tags. */
+static const int DN_MPI_TAG_RESULT = 1;
+static const int DN_MPI_TAG_TASK = 2;
+static const int DN_MPI_TAG_STOP = 3;
+
+/** Largest single message (in doubles) used when broadcasting. */
+static const long DN_MPI_CHUNK = 1L << 26;
+
+/**
+ * A block of runs for one output (a parameter point and ant).
+ */
+struct MpiTask {
+   int output;
+   int firstRun;
+   int runs;
+};
+
+/**
+ * Send the network loaded on the root rank to every other rank, which
+ * must have constructed it with the same size.
+ */
+inline void mpiBroadcastNet (DynamicNet &net, int root) {
+   int rank;
+   long size = 0, pos;
+   vector<double> buf;
+   MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+   if (rank == root) {
+      net.pack(buf);
+      size = buf.size();
+   }
+   MPI_Bcast(&size, 1, MPI_LONG, root, MPI_COMM_WORLD);
+   buf.resize(size);
+   // Split into pieces as counts are limited to an int
+   for (pos = 0; pos < size; pos += DN_MPI_CHUNK) {
+      int count = (int)min(DN_MPI_CHUNK, size - pos);
+      MPI_Bcast(&buf[pos], count, MPI_DOUBLE, root, MPI_COMM_WORLD);
+   }
+   if (rank != root) {
+      net.unpack(buf);
+      net.index();
+   }
+}
+
+/**
+ * Coordinator (rank 0). Hands out tasks in order as workers ask for them
+ * and passes each result to done (as a pointer to the packed values and
+ * their count). Returns once every worker has been told to stop.
+ */
+template <class Done>
+void mpiCoordinate (const vector<MpiTask> &tasks, Done done) {
+   int size, active, count;
+   size_t next = 0;
+   vector<double> buf;
+   MPI_Comm_size(MPI_COMM_WORLD, &size);
+   active = size - 1;
+   while (active > 0) {
+      MPI_Status status;
+      MPI_Probe(MPI_ANY_SOURCE, DN_MPI_TAG_RESULT, MPI_COMM_WORLD, &status);
+      MPI_Get_count(&status, MPI_DOUBLE, &count);
+      buf.resize(count > 0 ? count : 1);
+      MPI_Recv(&buf[0], count, MPI_DOUBLE, status.MPI_SOURCE, DN_MPI_TAG_RESULT, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+      if (count > 0) { done(&buf[0], count); }
+      if (next < tasks.size()) {
+         int task[3] = { tasks[next].output, tasks[next].firstRun, tasks[next].runs };
+         MPI_Send(task, 3, MPI_INT, status.MPI_SOURCE, DN_MPI_TAG_TASK, MPI_COMM_WORLD);
+         ++next;
+      }
+      else {
+         MPI_Send(NULL, 0, MPI_INT, status.MPI_SOURCE, DN_MPI_TAG_STOP, MPI_COMM_WORLD);
+         --active;
+      }
+   }
+}
+
+/**
+ * Worker (any other rank). Repeatedly asks for a task and calls work with
+ * it and an empty buffer to pack the result into, until told to stop.
+ */
+template <class Work>
+void mpiWork (Work work) {
+   vector<double> result;
+   while (true) {
+      MPI_Send(result.empty() ? NULL : &result[0], result.size(), MPI_DOUBLE, 0, DN_MPI_TAG_RESULT, MPI_COMM_WORLD);
+      int task[3];
+      MPI_Status status;
+      MPI_Recv(task, 3, MPI_INT, 0, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+      if (status.MPI_TAG == DN_MPI_TAG_STOP) { break; }
+      MpiTask t;
+      t.output = task[0];
+      t.firstRun = task[1];
+      t.runs = task[2];
+      result.clear();
+      work(t, result);
+   }
+}
+
+#endif // DN_DISTRIBUTED_H
@@ -10,28 +10,49 @@
  *===========================================================================*/
 
 #include <dynamic_nets.h>
+#include <telemetry.h>
+#include <sweep.h>
+#include <crn.h>
+#include <aggregate.h>
+#include <adaptive.h>
+#include <splitting.h>
+#include <gillespie.h>
+#include <compartments.h>
+#include <readers.h>
+#include <interactions.h>
+#include <ordering.h>
+#include <snapshots.h>
+#include <analytics.h>
+#include <server.h>
+#include <container.h>
+#include <columns.h>
+#ifdef DN_MPI
+#include <distributed.h>
+#endif
 #include <netevo.h>
+#include <csignal>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <thread>
 
 using namespace std;
 using namespace lemon;
 using namespace netevo;
 
-/**
- * Global of the nodes in the network (each is an ant).
- */
-vector<Node> nodes;
-
 /**
  * Print program usage.
  */
 void printUsage (void) {
    cout << "SI Spread Over Dynamic Networks Driven By Data (Version 2.0)" << endl;
-   cout << "Usage: dynNet FILENAME SIZE SI_PROB DECAY_RATE ANT RUNS LEN PREFIX" << endl;
-   cout << "  FILENAME:   Interaction data file." << endl;
+   cout << "Usage: dynNet [OPTIONS] FILENAME SIZE SI_PROB DECAY_RATE ANT RUNS LEN TIMESTEP OUT_FREQ PREFIX" << endl;
+   cout << "       dynNet --direct [OPTIONS] FILENAME SIZE SI_PROB ANT RUNS LEN TIMESTEP OUT_FREQ PREFIX" << endl;
+   cout << "  FILENAME:   Interaction data file (delayed crossings, or direct interactions" << endl;
+   cout << "              from, to, start, end with --direct)." << endl;
    cout << "  SIZE:       Number of ants in data file." << endl;
    cout << "  SI_PROB:    S->I transition probability." << endl;
    cout << "  DECAY_RATE: Decay rate of edge strength." << endl;
@@ -41,64 +62,226 @@ void printUsage (void) {
    cout << "  TIMESTEP:   Length of a time step." << endl;
    cout << "  OUT_FREQ:   Output frequency (timesteps)." << endl;
    cout << "  PREFIX:     Prefix for output files." << endl;
+   cout << "Options:" << endl;
+   cout << "  --direct              Direct interaction data: nodes interact during a step if" << endl;
+   cout << "                        an interaction starts or ends in it (same as" << endl;
+   cout << "                        --input=interval --interaction=overlap)." << endl;
+   cout << "  --input=FORMAT        Data format: crossing (default) or interval." << endl;
+   cout << "  --interaction=RULE    Interaction rule: delayed (default) or overlap." << endl;
+   cout << "  --serve=SOCKET        Load the data sets given as FILENAME SIZE pairs (instead" << endl;
+   cout << "                        of the arguments above) and answer simulation requests" << endl;
+   cout << "                        on the Unix domain socket SOCKET (see server.h)." << endl;
+   cout << "  --chunk=RUNS          Runs per task handed out when built with MPI (dynNetMPI)." << endl;
+   cout << "  --telemetry=SECS      Report progress to stderr every SECS seconds." << endl;
+   cout << "  --tick=LEN            Resolution of the data's times (default 1). Times are held" << endl;
+   cout << "                        as whole ticks, so the data's times and TIMESTEP must be" << endl;
+   cout << "                        multiples of LEN." << endl;
+   cout << "  --epoch=TIME          Time of tick 0; earlier data is rejected (default 0)." << endl;
+   cout << "                        Simulation times are measured from the epoch." << endl;
+   cout << "  --compress            Hold the crossings compressed (smaller, a little slower)." << endl;
+   cout << "                        The time ordered copy used by --gillespie and --model" << endl;
+   cout << "                        is not compressed." << endl;
+   cout << "  --reorder=ORDER       Renumber the nodes internally by degree or rcm (Reverse" << endl;
+   cout << "                        Cuthill-McKee) so nodes in contact are close in memory." << endl;
+   cout << "                        Input and output keep the data's numbering." << endl;
+   cout << "  --threads=N           Number of worker threads (default: all cores)." << endl;
+   cout << "  --sweep-si=VALUES     Sweep SI_PROB over VALUES (e.g. 0.1,0.2 or 0.1:0.1:0.5)." << endl;
+   cout << "  --sweep-decay=VALUES  Sweep DECAY_RATE over VALUES." << endl;
+   cout << "  --sweep-ts=VALUES     Sweep TIMESTEP over VALUES." << endl;
+   cout << "  --crn[=SEED]          Use common random numbers so every parameter point" << endl;
+   cout << "                        sees the same draw for the same contact event." << endl;
+   cout << "  --early-stop          End each run once its state can no longer change (every" << endl;
+   cout << "                        node infected, or no later contact can spread the" << endl;
+   cout << "                        infection), so its output stops there. Always on with" << endl;
+   cout << "                        --summary, which is unaffected by it." << endl;
+   cout << "  --gillespie           Continuous-time simulation; SI_PROB is the infection rate" << endl;
+   cout << "                        per unit time during a contact (delayed crossings only," << endl;
+   cout << "                        no --crn support)." << endl;
+   cout << "  --contact-duration=D  Length of each contact for --gillespie (default TIMESTEP)." << endl;
+   cout << "  --model=MODEL         Compartment model: SI, SIS, SIR or SEIR. States are" << endl;
+   cout << "                        0=S, 1=I, 2=R, 3=E (no --crn support). Rules other than" << endl;
+   cout << "                        delayed check every infectious and susceptible pair." << endl;
+   cout << "  --recovery=MEAN       Mean time infectious for SIS/SIR/SEIR (default 100)." << endl;
+   cout << "  --latency=MEAN        Mean time exposed for SEIR (default 10)." << endl;
+   cout << "  --delays=TYPE         Delay distribution: exp (default) or fixed." << endl;
+   cout << "  --snapshots=W[,S]     Instead of simulating, write the contact graph aggregated" << endl;
+   cout << "                        over windows of length W every S (default W) to" << endl;
+   cout << "                        PREFIXSNAPSHOTS.txt." << endl;
+   cout << "  --snapshot-weights=W  Arc weights: count (default) or decay (crossings decayed" << endl;
+   cout << "                        by DECAY_RATE with their age in the window)." << endl;
+   cout << "  --analytics           Instead of simulating, write the earliest arrival times" << endl;
+   cout << "                        between nodes to PREFIXARRIVAL.txt and each node's" << endl;
+   cout << "                        reach, temporal closeness, temporal betweenness and" << endl;
+   cout << "                        burstiness to PREFIXANALYTICS.txt." << endl;
+   cout << "  --container           Write every run to the single file PREFIXRUNS.dnc, indexed" << endl;
+   cout << "                        by point, ant and run (see container.h), instead of a" << endl;
+   cout << "                        file per ant." << endl;
+   cout << "  --columns             Write every run to PREFIXRUNS.dnt as fixed width columns" << endl;
+   cout << "                        (final size and infection time of each node) for memory" << endl;
+   cout << "                        mapped analysis (see columns.h)." << endl;
+   cout << "  --summary             Write only summary statistics to PREFIXSUMMARY.txt." << endl;
+   cout << "  --ci=WIDTH            Adaptive runs (implies --summary): run each point and ant" << endl;
+   cout << "                        until the 95% confidence interval of --ci-stat is at" << endl;
+   cout << "                        most WIDTH nodes wide, with RUNS as the limit." << endl;
+   cout << "  --ci-stat=STAT        Statistic for --ci: final (mean final size, default)," << endl;
+   cout << "                        curve (every point of the mean curve) or all." << endl;
+   cout << "  --min-runs=N          Runs before --ci is checked (default 20)." << endl;
+   cout << "  --split=LEVELS        Estimate the probability of outbreaks reaching the last of" << endl;
+   cout << "                        LEVELS (increasing infected counts, e.g. 5:5:25) by" << endl;
+   cout << "                        multilevel splitting with RUNS trials per level, written" << endl;
+   cout << "                        to PREFIXSPLIT.txt (no --crn, --gillespie or --model)." << endl;
+   cout << "  --reach=FRACTIONS     Fractions infected to time in the summary (default 0.1,0.5,0.9)." << endl;
+   cout << "  When sweeping, output for point P goes to PREFIXP<P>-ANT-<ANT>.txt and the" << endl;
+   cout << "  parameters of each point are listed in PREFIXPOINTS.txt." << endl;
 }
 
-/** 
- * Calculates the weight that edge should have given a delayed crossing.
- * t is the time period, a is the rate of decay. Use of an exponential
- * function ensures that result is in range (0, 1) for t >= 0
+/**
+ * Extract optional arguments of the form --name=value (or --name).
+ * Options may appear anywhere on the command line and are removed from
+ * argv so that the positional arguments are parsed as before.
  */
-double calcWeight (double t, double a) {
-   return exp(-a*t);
+map<string, string> parseOptions (int &argc, const char **argv) {
+   map<string, string> options;
+   int i, n = 1;
+   for (i=1; i<argc; ++i) {
+      string arg(argv[i]);
+      if (arg.compare(0, 2, "--") == 0) {
+         size_t eq = arg.find('=');
+         if (eq == string::npos) {
+            options[arg.substr(2)] = "";
+         }
+         else {
+            options[arg.substr(2, eq-2)] = arg.substr(eq+1);
+         }
+      }
+      else {
+         argv[n++] = argv[i];
+      }
+   }
+   argc = n;
+   return options;
 }
 
 /** 
  * SI Dynamics.
- * Uses the dynamic network from data to influence spread. We use the 
- * calcWeight() function to calculate a decay of the S->I probability
- * given a particular delay since last crossing.
+ * Uses the dynamic network from data to influence spread. The Interaction
+ * gives the weight of each contact, e.g. the calcWeight() decay of the S->I
+ * probability given a particular delay since last crossing.
  */
-class SIMap : public NodeDynamic {
+class SIMap : public NodeDynamic, public SimStopCondition {
 protected:
    double m_probSI;
    double m_decayRate;
-   DynamicNet &m_net;
-   double m_ts;
+   const DynamicNet &m_net;
+   const Interaction &m_interaction;
+   /** Length of a timestep in ticks. */
+   tick_t m_ts;
+   /** Tick each node was infected at in the current run (-1 = not infected). */
+   vector<tick_t> m_infectedTime;
+   unsigned long m_contacts;
+   /** Common random numbers (if enabled) and the current run they are keyed on. */
+   bool m_crn;
+   uint64_t m_crnSeed;
+   int m_ant;
+   int m_run;
+   /** Last crossing from an infected to a susceptible node and the infected count it was found for. */
+   tick_t m_horizon;
+   int m_horizonCount;
 public:   
-   SIMap (double probSI, double decayRate, DynamicNet &net, double ts) : m_probSI(probSI), 
-      m_decayRate(decayRate), m_net(net), m_ts(ts) { }
+   SIMap (double probSI, double decayRate, const DynamicNet &net, const Interaction &interaction, double ts) : 
+      m_probSI(probSI), m_decayRate(decayRate), m_net(net), m_interaction(interaction), m_ts(net.stepTicks(ts)),
+      m_infectedTime(net.getSize(), -1), m_contacts(0), m_crn(false), m_crnSeed(0), m_ant(0), m_run(0), 
+      m_horizon(-1), m_horizonCount(-1) { }
    string getName () { return "SIMap"; }
    int getStates () { return 1; } // (0 = Suseptible, 1 = Infected)
    void setDefaultParams (Node v, System &sys) { }
    
+   /** Change the model parameters (used when sweeping); ts must be a whole number of ticks. */
+   void setParams (double probSI, double decayRate, double ts) {
+      m_probSI = probSI;
+      m_decayRate = decayRate;
+      m_ts = m_net.stepTicks(ts);
+   }
+   
+   /** Use common random numbers generated from the given seed instead of the System generator (if crn). */
+   void setCommonRandomNumbers (bool crn, uint64_t seed) {
+      m_crn = crn;
+      m_crnSeed = seed;
+   }
+   
+   /** Infection times of the current run, and restoring saved ones to continue a run. */
+   const vector<tick_t> & infectedTimes () const { return m_infectedTime; }
+   void restore (const vector<tick_t> &infectedTime) {
+      m_infectedTime = infectedTime;
+      m_horizonCount = -1;
+   }
+   
+   /** Clear the infection times ready for a new run started from a given ant (node). */
+   void reset (int ant, int run) {
+      fill(m_infectedTime.begin(), m_infectedTime.end(), -1);
+      m_infectedTime[ant] = 0;
+      m_ant = m_net.getLabel(ant);
+      m_run = run;
+      m_horizonCount = -1;
+   }
+   
+   /**
+    * Stop condition: the epidemic can no longer change once every node is
+    * infected or no infected node has a crossing with a susceptible node
+    * after time t. The time of the last such crossing only changes when a
+    * node is infected, so it is recalculated only then.
+    */
+   bool stop (System &sys, const State &x, double t) {
+      int i, infected = 0;
+      int n = m_net.getSize();
+      
+      for (i=0; i<n; ++i) {
+         if (x[i] == 1.0) { ++infected; }
+      }
+      if (infected == n) { return true; }
+      
+      if (infected != m_horizonCount) {
+         m_horizon = m_net.getHorizon([&](int i) { return x[i] == 1.0; }, [&](int j) { return x[j] == 0.0; });
+         m_horizonCount = infected;
+      }
+      return ((long)m_ts * (long)t >= m_horizon);
+   }
+   
+   /** Running count of contacts evaluated (used for telemetry). */
+   const unsigned long & contactsEvaluated () { return m_contacts; }
+   
    void fn (Node v, System &sys, const State &x, State &dx, const double t) {
-      int i;
-      double tt;
+      int i, crossing;
+      tick_t tt;
       int vID = sys.stateID(v);
-      double prob, rndNum, crossTime;
+      double prob, rndNum, weight;
       
-      tt = m_ts * t;
+      tt = m_ts * (tick_t)t;
       
       // Only consider uninfected nodes
       if (x[vID] == 0.0) {
          // Search through all possible neighbours to see if infected
          for (i=0; i<m_net.getSize(); ++i) {
             if (i != vID && x[i] == 1.0) {
-               // If infected check that the nodes have crossed (edge exists i.e. != -1)
-               crossTime = m_net.getTimeSinceUpdate(i, vID, tt);
-               if (crossTime != -1.0) {
-                  // Check that the crossing time occured after the node was infected
-                  double infectedTime = m_net.getInfectedTime(i);
-                  if ( (infectedTime != -1.0) && ((tt-crossTime) >= infectedTime) ) {
-                     // Calculate the spread probability based on edge weight and standard probability
-                     prob = m_probSI * calcWeight(crossTime, m_decayRate);
-                     if (sys.rnd() <= prob) {
-                        // An infection has occured, stop searching any further
-                        dx[vID] = 1.0;
-                        // Update the infected time
-                        m_net.setInfectedTime(vID, tt);
-                        return;
-                     }
+               // If infected check that the nodes interact (edge exists i.e. != -1)
+               weight = m_interaction.weight(m_net, i, vID, tt, m_ts, m_decayRate, m_infectedTime[i], crossing);
+               ++m_contacts;
+               if (weight != -1.0) {
+                  // Calculate the spread probability based on edge weight and standard probability
+                  prob = m_probSI * weight;
+                  if (m_crn) {
+                     // Keyed on the original node numbers so relabelling keeps the draws
+                     rndNum = crnUniform(m_crnSeed, m_ant, m_run, m_net.getLabel(vID), m_net.getLabel(i), crossing);
+                  }
+                  else {
+                     rndNum = sys.rnd();
+                  }
+                  if (rndNum <= prob) {
+                     // An infection has occured, stop searching any further
+                     dx[vID] = 1.0;
+                     // Update the infected time
+                     m_infectedTime[vID] = tt;
+                     return;
                   }
                }
             }
@@ -110,74 +293,1045 @@ public:
    }
 };
 
+class ContextPool;
+
 /**
- * Run simulations for a particular ant and output to a given prefix.
- * This will output to file the results for a given ant. Each run is in
- * a separate file.
+ * Settings shared by every simulation in a set of runs.
  */
-void doRuns (System &sys, DynamicNet &dynNet, int ant, int runs, double simLen, double ts, int outFreq, const char *prefix) {
-   int i, j, k;
-   char buf[1000];
+struct RunSettings {
+   /** Timesteps per simulation. */
+   double simLen;
+   /** Output frequency (timesteps). */
+   int outFreq;
+   /** Prefix for output files. */
+   const char *prefix;
+   /** Rule deciding when nodes interact. */
+   Interaction *interaction;
+   /** Length of a tick and the time of tick 0 that data times are held relative to. */
+   double tick;
+   double epoch;
+   /** Hold the crossings compressed once loaded. */
+   bool compress;
+   /** Node ordering to relabel the network with (empty = keep the data's order). */
+   string reorder;
+   /** Number of worker threads. */
+   int threads;
+   /** Telemetry reporter (NULL if not used). */
+   Telemetry *tel;
+   /** Single file the runs are written to instead of a file per ant (NULL if not used). */
+   ContainerWriter *container;
+   /** Columnar store the runs are written to instead (NULL if not used). */
+   ColumnWriter *columns;
+   /** Simulation contexts reused between sets of runs. */
+   ContextPool *pool;
+   /** Use common random numbers and the seed to generate them from. */
+   bool crn;
+   uint64_t crnSeed;
+   /** Use the continuous-time engine and the length of each contact (0 = timestep). */
+   bool gillespie;
+   double contactDuration;
+   /** Use the compartment engine and the model to simulate. */
+   bool compartments;
+   CompartmentModel model;
+   /** Stop runs once they reach an absorbing state. */
+   bool earlyStop;
+   /** Aggregate statistics online instead of writing trajectories. */
+   bool summary;
+   /** Fractions of infected nodes to record the time taken to reach. */
+   vector<double> reachFractions;
+   /** Infected counts to split runs at (empty = plain runs). */
+   vector<int> splitLevels;
+   /** Confidence interval to run until (width 0 = a fixed number of runs) and the runs needed first. */
+   CITarget ci;
+   int minRuns;
+};
+
+/**
+ * Keeps the states of a run that are output: those at whole steps that
+ * are a multiple of the output frequency, and the final state. The
+ * buffers are kept between runs, so once sized for a network no run
+ * allocates.
+ */
+class SimObserverRows : public SimObserver {
+private:
+   int m_outFreq;
+public:
+   /** Output rows of the current run (the first rows entries are filled). */
+   vector<double> times;
+   vector<State> states;
+   int rows;
+   /** Last observation, if it was not an output row. */
+   bool lastIsRow;
+   double lastTime;
+   State last;
+   
+   SimObserverRows () : m_outFreq(1), rows(0), lastIsRow(true), lastTime(0.0) { }
+   
+   /** Size the buffers for runs of a number of states and output steps. */
+   void setOutput (int outFreq, int rowCount, int stateCount) {
+      m_outFreq = outFreq;
+      if (states.size() < rowCount) { states.resize(rowCount); }
+      if (times.size() < rowCount) { times.resize(rowCount); }
+      for (int i=0; i<states.size(); ++i) {
+         states[i].resize(stateCount);
+      }
+      last.resize(stateCount);
+   }
+   
+   /** Prepare for a new run. */
+   void reset () {
+      rows = 0;
+      lastIsRow = true;
+   }
    
-   // Generate a random initial state for the simulation
-   State initial = State(sys.totalStates(), 0.0);
-   initial[ant] = 1.0;
-   dynNet.setInfectedTime(ant, 0.0);
+   void operator() (const State &x, double t) {
+      if (t == floor(t) && (long)t % m_outFreq == 0) {
+         if (rows == states.size()) {
+            states.push_back(x);
+            times.push_back(t);
+         }
+         else {
+            states[rows] = x;
+            times[rows] = t;
+         }
+         ++rows;
+         lastIsRow = true;
+      }
+      else {
+         last = x;
+         lastTime = t;
+         lastIsRow = false;
+      }
+   }
+};
 
-   // Create a simulator for mapping dynamics
+/**
+ * Everything a worker thread needs to simulate independently of the
+ * others: its own System (and so random number generator), dynamics and
+ * output buffers. Only the DynamicNet is shared. Building a context is
+ * the expensive part (the System has a node per ant), so contexts are
+ * built once per network and reused from a ContextPool, being configured
+ * for the settings of each set of runs.
+ */
+class SimContext {
+public:
+   const DynamicNet &net;
+   System sys;
+   SIMap dyn;
    SimulateMap simMap;
+   SimulateTemporalGillespie gillespie;
+   SimulateCompartments compartments;
+   /** Initial state of each run (simulated in place). */
+   State initial;
+   /** Formatted output of the last run. */
+   ostringstream out;
+   SimObserverRows rowObserver;
+   SimObserverRunTrace traceObserver;
+   SimObserverTelemetry *telObserver;
+   /** Observer the simulation results go to (rows or trace). */
+   SimObserver *sink;
+   
+   SimContext (const DynamicNet &net, Interaction &interaction) : net(net), dyn(0.0, 0.0, net, interaction, 1.0),
+      gillespie(net), compartments(net), traceObserver(vector<int>(), net.getSize(), net.getLabels()), 
+      telObserver(NULL), sink(&rowObserver) {
+      sys.addNodeDynamic(&dyn);
+      sys.build(net.getSize(), &dyn, vector< pair<int,int> >(), sys.getArcDynamic("NoArcDynamic"));
+      sys.refreshStateIDs();
+      initial.resize(sys.totalStates());
+   }
+   
+   ~SimContext () { delete telObserver; }
+   
+   /** Configure for a set of runs recording the given output steps. */
+   void configure (const RunSettings &settings, const vector<int> &rowSteps) {
+      dyn.setCommonRandomNumbers(settings.crn, settings.crnSeed);
+      simMap.setStopCondition(settings.earlyStop ? &dyn : NULL);
+      gillespie.setOutFreq(settings.outFreq);
+      gillespie.setEarlyStop(settings.earlyStop);
+      compartments.setModel(settings.model);
+      compartments.setInteraction(settings.interaction);
+      compartments.setEarlyStop(settings.earlyStop);
+      bool trace = settings.summary || settings.columns != NULL;
+      if (trace) { traceObserver.setRowSteps(rowSteps); }
+      else { rowObserver.setOutput(settings.outFreq, rowSteps.size(), initial.size()); }
+      sink = trace ? (SimObserver *)&traceObserver : (SimObserver *)&rowObserver;
+      delete telObserver;
+      telObserver = NULL;
+      if (settings.tel != NULL) {
+         const unsigned long &contacts = settings.gillespie ? gillespie.contactsEvaluated() :
+         (settings.compartments ? compartments.contactsEvaluated() : dyn.contactsEvaluated());
+         telObserver = new SimObserverTelemetry(*settings.tel, *sink, contacts);
+      }
+   }
+   
+   /** Observer to pass to the simulator. */
+   SimObserver & observer () {
+      if (telObserver != NULL) { return *telObserver; }
+      return *sink;
+   }
+};
+
+/**
+ * Contexts kept for reuse between sets of runs: by the worker threads of
+ * each set, by every request of the server and by every block of runs
+ * an MPI rank is sent. Safe to use from any number of threads.
+ */
+class ContextPool {
+private:
+   mutex m_mutex;
+   vector<SimContext *> m_free;
+   vector<SimContext *> m_all;
+public:
+   ~ContextPool () {
+      for (int i=0; i<m_all.size(); ++i) {
+         delete m_all[i];
+      }
+   }
+   
+   /** A context for a network configured for the settings (building one if none is free). */
+   SimContext * acquire (const DynamicNet &net, const RunSettings &settings, const vector<int> &rowSteps) {
+      SimContext *ctx = NULL;
+      {
+         lock_guard<mutex> lock(m_mutex);
+         for (int i=0; i<m_free.size(); ++i) {
+            if (&m_free[i]->net == &net) {
+               ctx = m_free[i];
+               m_free.erase(m_free.begin() + i);
+               break;
+            }
+         }
+      }
+      if (ctx == NULL) {
+         ctx = new SimContext(net, *settings.interaction);
+         lock_guard<mutex> lock(m_mutex);
+         m_all.push_back(ctx);
+      }
+      ctx->configure(settings, rowSteps);
+      return ctx;
+   }
    
-   // Output the data to a vector for later writing to file
-   vector<double> tOut;
-   vector<State>  xOut;
-   SimObserverToVectors vectorObserver(xOut, tOut);
+   /** Return a context once its runs are done. */
+   void release (SimContext *ctx) {
+      lock_guard<mutex> lock(m_mutex);
+      m_free.push_back(ctx);
+   }
+};
+
+/**
+ * A context held from the pool for the lifetime of this object.
+ */
+class PooledContext {
+private:
+   ContextPool &m_pool;
+   SimContext *m_ctx;
+public:
+   PooledContext (const DynamicNet &net, const RunSettings &settings, const vector<int> &rowSteps) : 
+      m_pool(*settings.pool), m_ctx(settings.pool->acquire(net, settings, rowSteps)) { }
+   ~PooledContext () { m_pool.release(m_ctx); }
+   SimContext & operator* () { return *m_ctx; }
+   SimContext * operator-> () { return m_ctx; }
+};
 
-   // We don't need to log changes so use the default change logger that does nothing
+/**
+ * Run a single simulation started from a given ant (by its number in the
+ * data). The results are left
+ * in the context's sink observer.
+ */
+void simulateRun (SimContext &ctx, const SweepPoint &pt, int ant, int run, const RunSettings &settings) {
+   // Generate the initial state for the simulation
+   int node = ctx.net.getNode(ant);
+   fill(ctx.initial.begin(), ctx.initial.end(), 0.0);
+   ctx.initial[node] = 1.0;
+   ctx.dyn.setParams(pt.probSI, pt.decayRate, pt.ts);
+   ctx.dyn.reset(node, run);
+   
+   // Clear the output of the last run
+   ctx.rowObserver.reset();
+   ctx.traceObserver.reset();
+   
+   // Simulate the dynamics for our initial state (we don't need to log changes)
    ChangeLog nullLogger;
+   if (settings.gillespie) {
+      ctx.gillespie.setParams(pt.probSI, pt.decayRate, pt.ts, 
+                              settings.contactDuration > 0.0 ? settings.contactDuration : pt.ts);
+      ctx.gillespie.simulate(ctx.sys, settings.simLen, ctx.initial, ctx.observer(), nullLogger);
+   }
+   else if (settings.compartments) {
+      ctx.compartments.setParams(pt.probSI, pt.decayRate, pt.ts);
+      ctx.compartments.simulate(ctx.sys, settings.simLen, ctx.initial, ctx.observer(), nullLogger);
+   }
+   else {
+      ctx.simMap.simulate(ctx.sys, settings.simLen, ctx.initial, ctx.observer(), nullLogger);
+   }
+}
+
+/**
+ * Write a row of output: the run, time and the state of every node in
+ * the data's order.
+ */
+void writeRow (const DynamicNet &net, int run, double time, const State &x, ostream &out) {
+   out << (run+1) << "," << time << "," << (int)(x[net.getNode(0)]);
+   for (int k=1; k<x.size(); ++k) {
+      out << "," << (int)(x[net.getNode(k)]);
+   }
+   out << endl;
+}
 
-   // Create and open the file for output
-   sprintf(buf, "%sANT-%i.txt", prefix, ant+1);
-   ofstream outFile;
-   outFile.open(buf);
+/**
+ * Run a single simulation started from a given ant and format the
+ * results (every outFreq steps and the final step) into the context's
+ * out stream.
+ */
+void doRun (SimContext &ctx, const SweepPoint &pt, int ant, int run, const RunSettings &settings) {
+   simulateRun(ctx, pt, ant, run, settings);
    
-   // Simulate for the required number of times.
-   for (i=0; i<runs; ++i) {
-      
-      // Copy the initial state and clear output vectors
-      State initialCopy = initial;
-      tOut.clear();
-      xOut.clear();
-      
-      // Simulate the dynamics for our initial state and using the observer and logger
-      simMap.simulate(sys, simLen, initialCopy, vectorObserver, nullLogger);
-      
-      // Save the simulation results to file.
-      for (j=0; j<tOut.size(); ++j) {
-         if (j%outFreq == 0 || j == (tOut.size() - 1)) {
-            State curState = xOut[j];
-            outFile << (i+1) << "," << tOut[j] * ts << "," << (int)(curState[0]);
-            for (k=1; k<curState.size(); ++k) {
-               outFile << "," << (int)(curState[k]);
+   // Observations between steps are only output if they are the final state
+   ctx.out.str("");
+   const SimObserverRows &rows = ctx.rowObserver;
+   for (int j=0; j<rows.rows; ++j) {
+      writeRow(ctx.net, run, rows.times[j] * pt.ts, rows.states[j], ctx.out);
+   }
+   if (!rows.lastIsRow) {
+      writeRow(ctx.net, run, rows.lastTime * pt.ts, rows.last, ctx.out);
+   }
+}
+
+/**
+ * Open the summary file and write the header describing its records.
+ */
+void openSummary (ofstream &summaryFile, const char *prefix) {
+   char buf[1000];
+   sprintf(buf, "%sSUMMARY.txt", prefix);
+   summaryFile.open(buf);
+   summaryFile << "# CURVE,point,ant,time,mean,var,q05,q25,q50,q75,q95" << endl;
+   summaryFile << "# FINAL,point,ant,runs,mean,var,q05,q25,q50,q75,q95" << endl;
+   summaryFile << "# NODE,point,ant,node,prob,mean_time" << endl;
+   summaryFile << "# REACH,point,ant,fraction,runs_reached,mean_time,var,q05,q25,q50,q75,q95" << endl;
+}
+
+/**
+ * Run simulations for every parameter point and ant given, outputting
+ * to files with a given prefix (one file per point and ant, holding all
+ * runs in order). Each (point, ant, run) is an independent task; tasks
+ * are handed out to a pool of worker threads that share the network.
+ * In summary mode each run is folded into the statistics for its point
+ * and ant, which are written to a single file once all runs are done.
+ */
+void doRuns (const DynamicNet &net, const vector<SweepPoint> &grid, const vector<int> &ants, int runs, const RunSettings &settings) {
+   int p, a, i;
+   char buf[1000];
+   vector<int> rowSteps = outputSteps(settings.simLen, settings.outFreq);
+   
+   // Create an output for each point and ant (aggregates are created as their runs start)
+   vector<OrderedOutput *> outputs;
+   AggregateSet aggregates(grid.size() * ants.size(), net.getSize(), rowSteps, settings.reachFractions);
+   for (p=0; p<grid.size(); ++p) {
+      for (a=0; a<ants.size(); ++a) {
+         if (settings.summary || settings.container != NULL || settings.columns != NULL) { continue; }
+         if (grid.size() == 1) {
+            sprintf(buf, "%sANT-%i.txt", settings.prefix, ants[a]+1);
+         }
+         else {
+            sprintf(buf, "%sP%i-ANT-%i.txt", settings.prefix, p+1, ants[a]+1);
+         }
+         outputs.push_back(new OrderedOutput(buf, runs));
+      }
+   }
+   
+   // Single summary file for all points and ants
+   mutex summaryMutex;
+   ofstream summaryFile;
+   if (settings.summary) {
+      openSummary(summaryFile, settings.prefix);
+   }
+   
+   // Tasks are numbered so that runs of the same output are handed out together
+   long totalTasks = (long)grid.size() * ants.size() * runs;
+   atomic<long> nextTask(0);
+   
+   vector<thread> workers;
+   for (i=0; i<settings.threads; ++i) {
+      workers.push_back(thread([&]() {
+         PooledContext held(net, settings, rowSteps);
+         SimContext &ctx = *held;
+         long task;
+         while ((task = nextTask.fetch_add(1)) < totalTasks) {
+            int run = task % runs;
+            int output = task / runs;
+            const SweepPoint &pt = grid[output / ants.size()];
+            int ant = ants[output % ants.size()];
+            if (settings.summary) {
+               simulateRun(ctx, pt, ant, run, settings);
+               RunAggregate &agg = aggregates.get(output);
+               // The thread adding the last run writes and frees the statistics
+               if (agg.add(ctx.traceObserver) == (unsigned long)runs) {
+                  lock_guard<mutex> lock(summaryMutex);
+                  agg.write(summaryFile, output / ants.size() + 1, ant + 1, pt.ts);
+                  aggregates.release(output);
+               }
+            }
+            else if (settings.columns != NULL) {
+               simulateRun(ctx, pt, ant, run, settings);
+               const SimObserverRunTrace &trace = ctx.traceObserver;
+               settings.columns->write((uint64_t)output * runs + run, output / ants.size() + 1, ant + 1, run + 1,
+                                       trace.lastCount, trace.lastTime * pt.ts, trace.infectedStep, pt.ts);
+            }
+            else {
+               doRun(ctx, pt, ant, run, settings);
+               string data = ctx.out.str();
+               if (settings.container != NULL) {
+                  settings.container->append(output / ants.size() + 1, ant + 1, run + 1, data);
+               }
+               else {
+                  outputs[output]->submit(run, data);
+               }
+            }
+            if (settings.tel != NULL) { settings.tel->addRun(); }
+         }
+      }));
+   }
+   for (i=0; i<workers.size(); ++i) {
+      workers[i].join();
+   }
+   
+   for (i=0; i<outputs.size(); ++i) {
+      delete outputs[i];
+   }
+}
+
+/**
+ * Summary mode with adaptive run counts: runs of every point and ant are
+ * handed out in turn (see adaptive.h) until the confidence interval
+ * target is met or the maximum number of runs is reached. Statistics are
+ * written as each point and ant finishes.
+ */
+void adaptiveRuns (const DynamicNet &net, const vector<SweepPoint> &grid, const vector<int> &ants, int maxRuns, 
+                   const RunSettings &settings) {
+   int i;
+   vector<int> rowSteps = outputSteps(settings.simLen, settings.outFreq);
+   AggregateSet aggregates(grid.size() * ants.size(), net.getSize(), rowSteps, settings.reachFractions);
+   AdaptiveScheduler scheduler(aggregates.size(), settings.minRuns, maxRuns);
+   atomic<long> totalRuns(0);
+   
+   mutex summaryMutex;
+   ofstream summaryFile;
+   openSummary(summaryFile, settings.prefix);
+   
+   vector<thread> workers;
+   for (i=0; i<settings.threads; ++i) {
+      workers.push_back(thread([&]() {
+         PooledContext held(net, settings, rowSteps);
+         SimContext &ctx = *held;
+         int output, run;
+         while (scheduler.next(output, run)) {
+            const SweepPoint &pt = grid[output / ants.size()];
+            int ant = ants[output % ants.size()];
+            simulateRun(ctx, pt, ant, run, settings);
+            RunAggregate &agg = aggregates.get(output);
+            agg.add(ctx.traceObserver);
+            ++totalRuns;
+            if (settings.tel != NULL) { settings.tel->addRun(); }
+            // The thread completing the last run writes and frees the statistics
+            if (scheduler.complete(output, settings.ci.met(agg))) {
+               lock_guard<mutex> lock(summaryMutex);
+               agg.write(summaryFile, output / ants.size() + 1, ant + 1, pt.ts);
+               aggregates.release(output);
+            }
+         }
+      }));
+   }
+   for (i=0; i<workers.size(); ++i) {
+      workers[i].join();
+   }
+   cerr << "Simulated " << totalRuns << " of at most " << (long)maxRuns * aggregates.size() << " runs." << endl;
+}
+
+/**
+ * Continue a partial SI run until at least level nodes are infected
+ * (saving the run in s and returning true) or the run ends. steps counts
+ * the steps simulated.
+ */
+bool advanceSplit (SimContext &ctx, const SweepPoint &pt, SplitState &s, int level, const RunSettings &settings, 
+                   long &steps) {
+   int i, t, count;
+   int n = ctx.net.getSize();
+   State x(s.x), dx(x.size(), 0.0);
+   ctx.dyn.setParams(pt.probSI, pt.decayRate, pt.ts);
+   ctx.dyn.restore(s.infectedTime);
+   for (t = s.t + 1; t <= (int)settings.simLen; ++t) {
+      if (ctx.dyn.stop(ctx.sys, x, (double)(t-1))) { return false; }
+      ctx.sys(x, dx, (double)t);
+      x.swap(dx);
+      ++steps;
+      for (i=0, count=0; i<n; ++i) {
+         if (x[i] == 1.0) { ++count; }
+      }
+      if (count >= level) {
+         s.t = t;
+         s.x = x;
+         s.infectedTime = ctx.dyn.infectedTimes();
+         return true;
+      }
+   }
+   return false;
+}
+
+/**
+ * Estimate the probability of outbreaks reaching each split level for
+ * every point and ant by fixed effort multilevel splitting (see
+ * splitting.h). Each stage runs trials continuing the runs saved at the
+ * previous level in turn, shared between the worker threads.
+ */
+void splitRuns (const DynamicNet &net, const vector<SweepPoint> &grid, const vector<int> &ants, int trials, 
+                const RunSettings &settings) {
+   int p, a, k, i;
+   char buf[1000];
+   vector<int> rowSteps;
+   long totalSteps = 0;
+   
+   vector<SimContext *> contexts;
+   for (i=0; i<settings.threads; ++i) {
+      contexts.push_back(settings.pool->acquire(net, settings, rowSteps));
+   }
+   
+   sprintf(buf, "%sSPLIT.txt", settings.prefix);
+   ofstream outFile(buf);
+   outFile << "# LEVEL,point,ant,level,trials,hits,prob" << endl;
+   outFile << "# TAIL,point,ant,level,prob,rel_err,steps" << endl;
+   
+   for (p=0; p<grid.size(); ++p) {
+      for (a=0; a<ants.size(); ++a) {
+         const SweepPoint &pt = grid[p];
+         SplitEstimate estimate;
+         long steps = 0;
+         
+         // Every run starts from the ant alone
+         vector<SplitState> starts(1);
+         int node = net.getNode(ants[a]);
+         contexts[0]->dyn.reset(node, 0);
+         starts[0].t = 0;
+         starts[0].x.assign(net.getSize(), 0.0);
+         starts[0].x[node] = 1.0;
+         starts[0].infectedTime = contexts[0]->dyn.infectedTimes();
+         
+         for (k=0; k<settings.splitLevels.size(); ++k) {
+            int level = settings.splitLevels[k];
+            vector<SplitState> hits;
+            mutex hitsMutex;
+            atomic<long> nextTrial(0);
+            atomic<long> stageSteps(0);
+            vector<thread> workers;
+            for (i=0; i<contexts.size(); ++i) {
+               SimContext &ctx = *contexts[i];
+               workers.push_back(thread([&]() {
+                  long trial, localSteps = 0;
+                  while ((trial = nextTrial.fetch_add(1)) < trials) {
+                     SplitState s = starts[trial % starts.size()];
+                     if (advanceSplit(ctx, pt, s, level, settings, localSteps)) {
+                        lock_guard<mutex> lock(hitsMutex);
+                        hits.push_back(s);
+                     }
+                  }
+                  stageSteps += localSteps;
+               }));
+            }
+            for (i=0; i<workers.size(); ++i) {
+               workers[i].join();
+            }
+            steps += stageSteps;
+            estimate.addLevel(level, trials, hits.size());
+            if (hits.empty()) { break; }
+            starts.swap(hits);
+         }
+         
+         for (k=0; k<estimate.stages(); ++k) {
+            outFile << "LEVEL," << (p+1) << "," << (ants[a]+1) << "," << estimate.level(k) << "," 
+                    << estimate.trials(k) << "," << estimate.hits(k) << "," << estimate.prob(k) << endl;
+         }
+         k = settings.splitLevels.size() - 1;
+         double prob = (estimate.stages() == k+1) ? estimate.prob(k) : 0.0;
+         outFile << "TAIL," << (p+1) << "," << (ants[a]+1) << "," << settings.splitLevels[k] << "," << prob << ","
+                 << (prob > 0.0 ? estimate.relativeError(k) : -1.0) << "," << steps << endl;
+         totalSteps += steps;
+         if (settings.tel != NULL) { settings.tel->addRun(); }
+      }
+   }
+   
+   for (i=0; i<contexts.size(); ++i) {
+      settings.pool->release(contexts[i]);
+   }
+   cerr << "Simulated " << totalSteps << " steps." << endl;
+}
+
+/**
+ * Run every ant's runs (numbered from firstRun) for a single parameter
+ * point, folding each run into the aggregate for its ant. If seed is non-zero each run's generator is
+ * seeded from it, the ant and the run so results do not depend on which
+ * thread ran what.
+ */
+void aggregateRuns (const DynamicNet &net, const SweepPoint &pt, const vector<int> &ants, int firstRun, int runs, 
+                    const RunSettings &settings, uint64_t seed, vector<RunAggregate *> &aggregates) {
+   int i;
+   vector<int> rowSteps = outputSteps(settings.simLen, settings.outFreq);
+   long totalTasks = (long)ants.size() * runs;
+   atomic<long> nextTask(0);
+   
+   vector<thread> workers;
+   for (i=0; i<settings.threads; ++i) {
+      workers.push_back(thread([&]() {
+         PooledContext held(net, settings, rowSteps);
+         SimContext &ctx = *held;
+         long task;
+         while ((task = nextTask.fetch_add(1)) < totalTasks) {
+            int run = firstRun + task % runs;
+            int a = task / runs;
+            if (seed != 0) {
+               ctx.sys.seedRnd((int)(crnMix(crnMix(seed) ^ (((uint64_t)(uint32_t)ants[a] << 32) | (uint32_t)run)) >> 33));
             }
-            outFile << endl;
+            simulateRun(ctx, pt, ants[a], run, settings);
+            aggregates[a]->add(ctx.traceObserver);
+         }
+      }));
+   }
+   for (i=0; i<workers.size(); ++i) {
+      workers[i].join();
+   }
+}
+
+#ifdef DN_MPI
+/**
+ * Distributed version of doRuns() in summary mode. Rank 0 splits each
+ * (point, ant) into blocks of at most chunk runs and hands them out to
+ * the other ranks, which simulate them with their own worker threads and
+ * return the packed statistics. Rank 0 merges the blocks and writes each
+ * (point, ant) to the summary file as soon as all of its runs are in.
+ */
+void mpiRuns (const DynamicNet &net, const vector<SweepPoint> &grid, const vector<int> &ants, int runs, 
+              int chunk, const RunSettings &settings) {
+   int rank, o, r;
+   int outputs = grid.size() * ants.size();
+   vector<int> rowSteps = outputSteps(settings.simLen, settings.outFreq);
+   MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+   
+   if (rank != 0) {
+      mpiWork([&](const MpiTask &task, vector<double> &result) {
+         vector<int> ant(1, ants[task.output % ants.size()]);
+         vector<RunAggregate *> aggregates(1, new RunAggregate(net.getSize(), rowSteps, settings.reachFractions));
+         aggregateRuns(net, grid[task.output / ants.size()], ant, task.firstRun, task.runs, settings, 0, aggregates);
+         result.push_back(task.output);
+         aggregates[0]->pack(result);
+         delete aggregates[0];
+      });
+      return;
+   }
+   
+   // Runs of the same output are handed out together so it completes early
+   vector<MpiTask> tasks;
+   for (o=0; o<outputs; ++o) {
+      for (r=0; r<runs; r+=chunk) {
+         MpiTask task;
+         task.output = o;
+         task.firstRun = r;
+         task.runs = min(chunk, runs - r);
+         tasks.push_back(task);
+      }
+   }
+   
+   ofstream summaryFile;
+   openSummary(summaryFile, settings.prefix);
+   AggregateSet aggregates(outputs, net.getSize(), rowSteps, settings.reachFractions);
+   RunAggregate block(net.getSize(), rowSteps, settings.reachFractions);
+   mpiCoordinate(tasks, [&](const double *buf, int count) {
+      int output = (int)*buf++;
+      block.unpack(buf);
+      RunAggregate &agg = aggregates.get(output);
+      agg.merge(block);
+      if (settings.tel != NULL) {
+         for (unsigned long k=0; k<block.runs(); ++k) { settings.tel->addRun(); }
+      }
+      if (agg.runs() == (unsigned long)runs) {
+         agg.write(summaryFile, output / ants.size() + 1, ants[output % ants.size()] + 1, grid[output / ants.size()].ts);
+         aggregates.release(output);
+      }
+   });
+}
+#endif
+
+/**
+ * Write the list of parameter points used in a sweep.
+ */
+void writePoints (const vector<SweepPoint> &grid, const char *prefix) {
+   char buf[1000];
+   sprintf(buf, "%sPOINTS.txt", prefix);
+   ofstream outFile(buf);
+   outFile << "point,si_prob,decay_rate,timestep" << endl;
+   for (int p=0; p<grid.size(); ++p) {
+      outFile << (p+1) << "," << grid[p].probSI << "," << grid[p].decayRate << "," << grid[p].ts << endl;
+   }
+}
+
+/**
+ * Write a line for every window of the aggregated contact graph: its
+ * start and end, the number of arcs, their total weight and the number
+ * of weakly connected components.
+ */
+void writeSnapshots (const DynamicNet &net, double window, double step, snapshot_weight_e weights, 
+                     double decayRate, const char *prefix) {
+   char buf[1000];
+   System sys;
+   SnapshotBuilder snapshots(net, sys, window, step, weights, decayRate);
+   sprintf(buf, "%sSNAPSHOTS.txt", prefix);
+   ofstream outFile(buf);
+   outFile << "start,end,arcs,weight,components" << endl;
+   while (snapshots.next()) {
+      double total = 0.0;
+      for (System::ArcIt a(sys); a != INVALID; ++a) {
+         total += sys.arcData(a).weight;
+      }
+      outFile << snapshots.start() * net.getTick() << "," << snapshots.end() * net.getTick() << "," 
+              << countArcs(sys) << "," << total << "," << sys.weaklyConnectedComponents() << endl;
+   }
+}
+
+/**
+ * Write the temporal statistics of every node (see analytics.h), in the
+ * data's node order: a line per node of the statistics and a row per
+ * source of the earliest arrival times (NA if never reached).
+ */
+void writeAnalytics (const DynamicNet &net, int threads, const char *prefix) {
+   char buf[1000];
+   int i, j, n = net.getSize();
+   TemporalAnalytics analytics(net);
+   analytics.run(threads);
+   
+   sprintf(buf, "%sANALYTICS.txt", prefix);
+   ofstream outFile(buf);
+   outFile << "node,reach,closeness,betweenness,burstiness" << endl;
+   for (i=0; i<n; ++i) {
+      int v = net.getNode(i);
+      outFile << (i+1) << "," << analytics.reach()[v] << "," << analytics.closeness()[v] << "," 
+              << analytics.betweenness()[v] << "," << analytics.burstiness()[v] << endl;
+   }
+   
+   sprintf(buf, "%sARRIVAL.txt", prefix);
+   ofstream arrivalFile(buf);
+   for (i=0; i<n; ++i) {
+      arrivalFile << (i+1);
+      for (j=0; j<n; ++j) {
+         tick_t t = analytics.arrival(net.getNode(i), net.getNode(j));
+         if (t < 0) { arrivalFile << ",NA"; }
+         else { arrivalFile << "," << t * net.getTick(); }
+      }
+      arrivalFile << endl;
+   }
+}
+
+/**
+ * Set up the engine from the options: the input format, interaction rule,
+ * worker threads and simulation modes. Returns false (after reporting the
+ * problem) if the options are invalid.
+ */
+bool configure (map<string, string> &options, bool direct, RunSettings &settings, ContactReader *&reader) {
+   // Input format and interaction rule
+   string input = direct ? "interval" : "crossing";
+   string rule = direct ? "overlap" : "delayed";
+   if (options.count("input") > 0) { input = options["input"]; }
+   if (options.count("interaction") > 0) { rule = options["interaction"]; }
+   if (input == "crossing") { reader = new CrossingReader(); }
+   else if (input == "interval") { reader = new IntervalReader(); }
+   else {
+      cerr << "Error: unknown input format " << input << "." << endl;
+      return false;
+   }
+   if (rule == "delayed") { settings.interaction = new DelayedCrossing(); }
+   else if (rule == "overlap") { settings.interaction = new WindowOverlap(); }
+   else {
+      cerr << "Error: unknown interaction rule " << rule << "." << endl;
+      return false;
+   }
+   
+   // Resolution of the data's times
+   settings.tick = (options.count("tick") > 0) ? atof(options["tick"].c_str()) : 1.0;
+   settings.epoch = (options.count("epoch") > 0) ? atof(options["epoch"].c_str()) : 0.0;
+   if (settings.tick <= 0.0) {
+      cerr << "Error: the tick length must be positive." << endl;
+      return false;
+   }
+   
+   settings.compress = (options.count("compress") > 0);
+   settings.reorder = (options.count("reorder") > 0) ? options["reorder"] : "";
+   if (!settings.reorder.empty() && settings.reorder != "degree" && settings.reorder != "rcm") {
+      cerr << "Error: unknown node ordering " << settings.reorder << "." << endl;
+      return false;
+   }
+   
+   // Number of worker threads
+   settings.threads = thread::hardware_concurrency();
+   if (options.count("threads") > 0) { settings.threads = atoi(options["threads"].c_str()); }
+   if (settings.threads < 1) { settings.threads = 1; }
+   
+   // Common random numbers (seeded so a sweep can be extended later)
+   settings.crn = (options.count("crn") > 0);
+   settings.crnSeed = 1;
+   if (settings.crn && !options["crn"].empty()) { settings.crnSeed = strtoull(options["crn"].c_str(), NULL, 10); }
+   
+   // Summary statistics only
+   settings.summary = (options.count("summary") > 0);
+   settings.reachFractions = parseValues(options.count("reach") > 0 ? options["reach"] : "0.1,0.5,0.9");
+   if (settings.reachFractions.empty() && options.count("reach") > 0 && !options["reach"].empty()) {
+      cerr << "Error: malformed --reach fractions (ranges are START:STEP:END)." << endl;
+      return false;
+   }
+   
+   // Continuous-time engine
+   settings.gillespie = (options.count("gillespie") > 0);
+   settings.contactDuration = 0.0;
+   if (options.count("contact-duration") > 0) { settings.contactDuration = atof(options["contact-duration"].c_str()); }
+   
+   // Compartment models (times are in the units of the data)
+   settings.compartments = (options.count("model") > 0);
+   if (settings.compartments) {
+      double recovery = (options.count("recovery") > 0) ? atof(options["recovery"].c_str()) : 100.0;
+      double latency = (options.count("latency") > 0) ? atof(options["latency"].c_str()) : 10.0;
+      bool exponential = (options.count("delays") == 0 || options["delays"] != "fixed");
+      if (!settings.model.byName(options["model"], latency, recovery, exponential)) {
+         cerr << "Error: unknown model " << options["model"] << "." << endl;
+         return false;
+      }
+      if (settings.gillespie) {
+         cerr << "Error: --model can not be used with --gillespie." << endl;
+         return false;
+      }
+   }
+   
+   // The continuous-time engine only supports delayed crossings
+   if (settings.gillespie && rule != "delayed") {
+      cerr << "Error: --gillespie requires --interaction=delayed." << endl;
+      return false;
+   }
+   
+   // Adaptive run counts work from the summary statistics
+   settings.ci.width = (options.count("ci") > 0) ? atof(options["ci"].c_str()) : 0.0;
+   if (options.count("ci-stat") > 0) { settings.ci.stat = options["ci-stat"]; }
+   settings.minRuns = (options.count("min-runs") > 0) ? max(2, atoi(options["min-runs"].c_str())) : 20;
+   if (settings.ci.width < 0.0 || !settings.ci.valid()) {
+      cerr << "Error: --ci needs a positive width and --ci-stat one of final, curve or all." << endl;
+      return false;
+   }
+   if (settings.ci.width > 0.0) { settings.summary = true; }
+   
+   // Multilevel splitting (continues runs of the SI engine so draws can not be shared)
+   if (options.count("split") > 0) {
+      vector<double> levels = parseValues(options["split"]);
+      for (int i=0; i<levels.size(); ++i) {
+         if (levels[i] < 2 || (i > 0 && levels[i] <= levels[i-1])) {
+            cerr << "Error: --split levels must be increasing infected counts above 1." << endl;
+            return false;
          }
+         settings.splitLevels.push_back((int)levels[i]);
+      }
+      if (settings.splitLevels.empty() || settings.crn || settings.gillespie || settings.compartments) {
+         cerr << "Error: --split needs levels and can not be used with --crn, --gillespie or --model." << endl;
+         return false;
       }
    }
    
-   // Finish writing to file
-   outFile.close();
+   // Summaries are unaffected by stopping early so always do so
+   settings.earlyStop = (options.count("early-stop") > 0 || settings.summary);
+   settings.tel = NULL;
+   settings.container = NULL;
+   settings.columns = NULL;
+   settings.pool = NULL;
+   settings.prefix = "";
+   return true;
+}
+
+/**
+ * Relabel a loaded network if requested, build the indexes it needs for
+ * the chosen engines and compress it if requested. Compression comes last
+ * as the indexes are built from the uncompressed crossings.
+ */
+void prepareNet (DynamicNet &net, const RunSettings &settings, bool timeline) {
+   if (!settings.reorder.empty()) { net.relabel(nodeOrder(net, settings.reorder)); }
+   settings.interaction->prepare(net);
+   if (timeline) { net.indexByTime(); }
+   if (settings.compress) {
+      size_t raw = net.crossingBytes();
+      net.compress();
+      cerr << "Compressed " << net.countCrossings() << " crossings from " << raw << " to " 
+           << net.crossingBytes() << " bytes." << endl;
+   }
+}
+
+/**
+ * Server mode: load every data set given as FILENAME SIZE pairs on the
+ * command line, then answer requests on a Unix domain socket (see
+ * server.h) until a shutdown request is received. Requests are handled
+ * one at a time, each using every worker thread.
+ */
+int serve (const string &path, int argc, const char **argv, RunSettings &settings, ContactReader &reader) {
+   int i;
+   
+   if (argc < 3 || argc % 2 == 0) {
+      printUsage();
+      return 1;
+   }
+   
+   // Load and index every data set once (all engines are available)
+   vector<DynamicNet *> nets;
+   for (i=1; i+1<argc; i+=2) {
+      DynamicNet *net = new DynamicNet(atoi(argv[i+1]), settings.tick, settings.epoch);
+      if (net->getSize() <= 0 || !reader.load(argv[i], *net)) {
+         cerr << "Error: could not load data set " << argv[i] << "." << endl;
+         return 1;
+      }
+      prepareNet(*net, settings, true);
+      nets.push_back(net);
+   }
+   
+   Server server(path);
+   if (!server.listen()) {
+      return 1;
+   }
+   // A client leaving before reading its response must only end its connection
+   signal(SIGPIPE, SIG_IGN);
+   cerr << "Serving " << nets.size() << " data set(s) on " << path << endl;
+   
+   bool running = true;
+   while (running) {
+      int fd = server.accept();
+      if (fd < 0) {
+         cerr << "Error: accept failed (" << strerror(errno) << ")." << endl;
+         break;
+      }
+      ServerConnection conn(fd);
+      ServerRequest req;
+      while (running && conn.readRequest(req)) {
+         if (req.flags & SERVER_FLAG_SHUTDOWN) {
+            running = false;
+            break;
+         }
+         
+         // Check the request against the data set
+         if (req.dataset >= nets.size()) { conn.sendError("unknown data set"); continue; }
+         const DynamicNet &net = *nets[req.dataset];
+         if (req.ant > net.getSize()) { conn.sendError("incorrect ant number"); continue; }
+         if (req.runs == 0 || req.len == 0 || req.outFreq == 0 || net.stepTicks(req.ts) < 0) {
+            conn.sendError("runs, len and outFreq must be positive and ts a whole number of ticks");
+            continue;
+         }
+         if (req.runs > INT_MAX || req.len >= INT_MAX || req.outFreq > INT_MAX ||
+             ((long)req.len / req.outFreq + 2) * (req.ant == 0 ? net.getSize() : 1) > SERVER_MAX_CURVE) {
+            conn.sendError("runs, len or the curve (len / outFreq rows for each ant) too large");
+            continue;
+         }
+         if ((req.flags & SERVER_FLAG_GILLESPIE) && (settings.compartments || dynamic_cast<DelayedCrossing *>(settings.interaction) == NULL)) {
+            conn.sendError("gillespie requires delayed crossings and no --model");
+            continue;
+         }
+         
+         // Settings for this request
+         RunSettings reqSettings = settings;
+         reqSettings.simLen = req.len;
+         reqSettings.outFreq = req.outFreq;
+         reqSettings.gillespie = (req.flags & SERVER_FLAG_GILLESPIE) != 0;
+         reqSettings.contactDuration = req.contactDuration;
+         reqSettings.crn = (req.flags & SERVER_FLAG_CRN) != 0;
+         reqSettings.crnSeed = req.seed;
+         reqSettings.summary = true;
+         reqSettings.earlyStop = true;
+         SweepPoint pt;
+         pt.probSI = req.probSI;
+         pt.decayRate = req.decayRate;
+         pt.ts = req.ts;
+         
+         vector<int> ants;
+         if (req.ant == 0) {
+            for (i=0; i<net.getSize(); ++i) { ants.push_back(i); }
+         }
+         else {
+            ants.push_back(req.ant-1);
+         }
+         vector<int> rowSteps = outputSteps(reqSettings.simLen, reqSettings.outFreq);
+         vector<RunAggregate *> aggregates;
+         for (i=0; i<ants.size(); ++i) {
+            aggregates.push_back(new RunAggregate(net.getSize(), rowSteps, reqSettings.reachFractions));
+         }
+         
+         aggregateRuns(net, pt, ants, 0, req.runs, reqSettings, req.seed, aggregates);
+         bool sent = conn.sendResults(ants, aggregates, net.getSize(), pt.ts);
+         
+         for (i=0; i<aggregates.size(); ++i) {
+            delete aggregates[i];
+         }
+         if (!sent) { break; }
+      }
+   }
+   
+   for (i=0; i<nets.size(); ++i) {
+      delete nets[i];
+   }
+   return 0;
 }
 
 /** 
- * Main function.
+ * Run the program (on every rank when using MPI).
  */
-int main (int argc, const char **argv) {
-   double probSI, decayRate, simLen, ts;
-   int num, ant, runs, i, outFreq;
-   const char *netFile, *prefix;
+int runMain (int argc, const char **argv) {
+   double probSI, decayRate, ts;
+   int num, ant, runs, i;
+   const char *netFile;
+   RunSettings settings;
+   ContactReader *reader = NULL;
+   
+   // Strip out any optional arguments
+   map<string, string> options = parseOptions(argc, argv);
+   
+   // Direct data has no decay rate so the later arguments shift down one
+   bool direct = (options.count("direct") > 0);
+   int shift = direct ? 1 : 0;
+   
+   // The reader, rule and any outputs created are freed on every return
+   settings.interaction = NULL;
+   bool configured = configure(options, direct, settings, reader);
+   unique_ptr<ContactReader> readerOwner(reader);
+   unique_ptr<Interaction> interaction(settings.interaction);
+   unique_ptr<Telemetry> tel;
+   unique_ptr<ContainerWriter> container;
+   unique_ptr<ColumnWriter> columns;
+   if (!configured) {
+      return 1;
+   }
+   ContextPool pool;
+   settings.pool = &pool;
+   
+   // This process's rank and, when distributed, the number of processes (ranks)
+   int rank = 0;
+#ifdef DN_MPI
+   int ranks = 1;
+   MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+   MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+   if (ranks > 1) {
+      if (options.count("serve") > 0 || settings.ci.width > 0.0 || !settings.splitLevels.empty()) {
+         if (rank == 0) { cerr << "Error: --serve, --ci and --split can not be used with MPI." << endl; }
+         return 1;
+      }
+      // Ranks normally match cores so each uses a single thread by default
+      if (options.count("threads") == 0) { settings.threads = 1; }
+      // Only summaries are gathered
+      if (!settings.summary && rank == 0) { cerr << "Note: writing summary statistics only when using MPI." << endl; }
+      settings.summary = true;
+      settings.earlyStop = true;
+   }
+#endif
+   
+   // Server mode takes only data sets as arguments
+   if (options.count("serve") > 0) {
+      return serve(options["serve"], argc, argv, settings, *reader);
+   }
    
    // Check that there is a correct number of arguments.
-   if (argc < 9 || argc > 11) {
+   if (argc < 9-shift || argc > 11-shift) {
       printUsage();
       return 1;
    }
@@ -186,44 +1340,158 @@ int main (int argc, const char **argv) {
    netFile = argv[1];
    num = atoi(argv[2]);
    probSI = atof(argv[3]);
-   decayRate = atof(argv[4]);
-   ant = atoi(argv[5]);
-   runs = atoi(argv[6]);
-   simLen = atof(argv[7]);
-   ts = atof(argv[8]);
-   outFreq = atoi(argv[9]);
-   if (argc == 11) { prefix = argv[10]; }
+   decayRate = direct ? 0.0 : atof(argv[4]);
+   ant = atoi(argv[5-shift]);
+   runs = atoi(argv[6-shift]);
+   settings.simLen = atof(argv[7-shift]);
+   ts = atof(argv[8-shift]);
+   settings.outFreq = atoi(argv[9-shift]);
+   if (argc == 11-shift) { settings.prefix = argv[10-shift]; }
    
-   // Create a dynamic network structure used by the dynamics.
-   // Must provide size of network and file name.
-   DynamicNet net = DynamicNet(num, netFile);
-   
-   // Create the system.
-   System sys;
+   // Check the ant is valid before starting anything
+   if (ant != -1 && (ant <= 0 || ant > num)) {
+      cerr << "Error: incorrect ant number specified." << endl;
+      return 1;
+   }
    
-   // Load the required dynamics.
-   SIMap vDyn(probSI, decayRate, net, ts);
-   sys.addNodeDynamic(&vDyn);
+   // Build the parameter grid (a single point unless sweeping)
+   vector<double> probs(1, probSI), decays(1, decayRate), tss(1, ts);
+   if (options.count("sweep-si") > 0) { probs = parseValues(options["sweep-si"]); }
+   if (options.count("sweep-decay") > 0) { decays = parseValues(options["sweep-decay"]); }
+   if (options.count("sweep-ts") > 0) { tss = parseValues(options["sweep-ts"]); }
+   vector<SweepPoint> grid = buildGrid(probs, decays, tss);
+   if (grid.empty()) {
+      cerr << "Error: empty or malformed parameter sweep (ranges are START:STEP:END)." << endl;
+      return 1;
+   }
+   for (i=0; i<grid.size(); ++i) {
+      if (stepTicks(grid[i].ts, settings.tick) < 0) {
+         cerr << "Error: TIMESTEP " << grid[i].ts << " is not a whole number of ticks." << endl;
+         return 1;
+      }
+   }
    
-   // Add the nodes with the SI dynamics.
-   for (i=0; i<num; ++i) {
-      nodes.push_back(sys.addNode("SIMap"));
+   // Snapshot windows (in place of the simulations)
+   bool snapshots = (options.count("snapshots") > 0);
+   vector<double> snapshotSpec = parseValues(snapshots ? options["snapshots"] : "");
+   snapshot_weight_e snapshotWeights = SNAPSHOT_COUNT;
+   if (snapshots) {
+      if (snapshotSpec.size() == 1) { snapshotSpec.push_back(snapshotSpec[0]); }
+      if (snapshotSpec.size() != 2 || stepTicks(snapshotSpec[0], settings.tick) < 0 || 
+          stepTicks(snapshotSpec[1], settings.tick) < 0) {
+         cerr << "Error: snapshot windows must be whole numbers of ticks." << endl;
+         return 1;
+      }
+      if (options.count("snapshot-weights") > 0 && options["snapshot-weights"] != "count") {
+         if (options["snapshot-weights"] != "decay") {
+            cerr << "Error: unknown snapshot weights " << options["snapshot-weights"] << "." << endl;
+            return 1;
+         }
+         snapshotWeights = SNAPSHOT_DECAY;
+      }
    }
    
-   // Run the simulations for an individual ant or all ants.
+   // Ants to start infected
+   vector<int> ants;
    if (ant == -1) {
-      for (i=0; i<num; ++i) {
-         doRuns(sys, net, i, runs, simLen, ts, outFreq, prefix);
+      for (i=0; i<num; ++i) { ants.push_back(i); }
+   }
+   else {
+      ants.push_back(ant-1);
+   }
+   
+   // Create a dynamic network structure used by the dynamics.
+   // Must provide size of network and file name. This is loaded once
+   // and shared by every simulation.
+   DynamicNet net(num, settings.tick, settings.epoch);
+   if (rank == 0 && !reader->load(netFile, net)) {
+#ifdef DN_MPI
+      if (ranks > 1) { MPI_Abort(MPI_COMM_WORLD, 1); }
+#endif
+      return 1;
+   }
+   readerOwner.reset();
+#ifdef DN_MPI
+   // Only the first rank reads the file, the rest receive it
+   if (ranks > 1) { mpiBroadcastNet(net, 0); }
+#endif
+   bool analytics = (options.count("analytics") > 0);
+   prepareNet(net, settings, settings.gillespie || settings.compartments || snapshots || analytics);
+   
+   if (snapshots || analytics) {
+      if (rank == 0 && snapshots) { 
+         writeSnapshots(net, snapshotSpec[0], snapshotSpec[1], snapshotWeights, decayRate, settings.prefix);
       }
+      if (rank == 0 && analytics) { writeAnalytics(net, settings.threads, settings.prefix); }
+      return 0;
    }
-   else if (ant > 0 && ant <= num) {
-      doRuns(sys, net, ant-1, runs, simLen, ts, outFreq, prefix);
+   
+   // Start the telemetry reporter if requested
+   if (options.count("telemetry") > 0 && rank == 0) {
+      double interval = atof(options["telemetry"].c_str());
+      if (interval <= 0.0) { interval = 10.0; }
+      // Splitting reports each point and ant as a run
+      unsigned long tasks = settings.splitLevels.empty() ? (unsigned long)runs : 1UL;
+      tel.reset(new Telemetry(tasks * ants.size() * grid.size(), interval, cerr));
+      settings.tel = tel.get();
+      settings.tel->start();
    }
-   else {
-      cerr << "Error: incorrect ant number specified." << endl;
+   
+   // Run the simulations for all points and ants.
+   if (grid.size() > 1 && rank == 0) {
+      writePoints(grid, settings.prefix);
+   }
+#ifdef DN_MPI
+   if (ranks > 1) {
+      // By default split the runs so each worker receives around eight blocks
+      long totalRuns = (long)runs * ants.size() * grid.size();
+      int chunk = (int)min((long)runs, max(1L, totalRuns / (8L * (ranks - 1))));
+      if (options.count("chunk") > 0) { chunk = max(1, atoi(options["chunk"].c_str())); }
+      mpiRuns(net, grid, ants, runs, chunk, settings);
+      return 0;
+   }
+#endif
+   // A single container file or columnar store in place of a file per ant (trajectories only)
+   bool trajectories = (!settings.summary && settings.splitLevels.empty());
+   if (options.count("container") > 0 && options.count("columns") > 0) {
+      cerr << "Error: --container and --columns can not be used together." << endl;
       return 1;
    }
+   if (options.count("container") > 0 && trajectories) {
+      container.reset(new ContainerWriter(string(settings.prefix) + "RUNS.dnc"));
+      settings.container = container.get();
+      if (!settings.container->isOpen()) { return 1; }
+   }
+   if (options.count("columns") > 0 && trajectories) {
+      columns.reset(new ColumnWriter(string(settings.prefix) + "RUNS.dnt", num, (uint64_t)runs * ants.size() * grid.size()));
+      settings.columns = columns.get();
+      if (!settings.columns->isOpen()) { return 1; }
+   }
    
-   // Ended successfully.
-   return 0;
+   if (!settings.splitLevels.empty()) { splitRuns(net, grid, ants, runs, settings); }
+   else if (settings.ci.width > 0.0) { adaptiveRuns(net, grid, ants, runs, settings); }
+   else { doRuns(net, grid, ants, runs, settings); }
+   
+   int result = 0;
+   if (container && !container->close()) { result = 1; }
+   if (columns && !columns->close()) { result = 1; }
+   
+   // Write the final telemetry line
+   tel.reset();
+   
+   return result;
+}
+
+/** 
+ * Main function.
+ */
+int main (int argc, const char **argv) {
+#ifdef DN_MPI
+   MPI_Init(&argc, (char ***)&argv);
+   int result = runMain(argc, argv);
+   MPI_Finalize();
+   return result;
+#else
+   return runMain(argc, argv);
+#endif
 }
@@ -5,6 +5,9 @@
  * easily calculated.
  */
 
+#ifndef DN_DYNAMIC_NETS_H
+#define DN_DYNAMIC_NETS_H
+
 #include <cstdlib>
 #include <cstring>
 #include <vector>
@@ -12,146 +15,453 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+#include <compressed.h>
 
 using namespace std;
 
+/**
+ * Times are held as whole ticks of a fixed length after the data set's
+ * epoch so they compare exactly and take half the space of a double.
+ */
+typedef int32_t tick_t;
+
+/** 
+ * Calculates the weight that edge should have given a delayed crossing.
+ * t is the time period, a is the rate of decay. Use of an exponential
+ * function ensures that result is in range (0, 1) for t >= 0
+ */
+inline double calcWeight (double t, double a) {
+   return exp(-a*t);
+}
+
+/**
+ * Converts the length of a timestep to ticks of a given length. Returns
+ * -1 unless it is a positive whole number of ticks.
+ */
+inline tick_t stepTicks (double ts, double tick) {
+   double t = floor(ts / tick + 0.5);
+   if (t < 1.0 || t > 2147483647.0 || fabs(t * tick - ts) > 1e-6 * tick) { return -1; }
+   return (tick_t)t;
+}
+
+/**
+ * A single crossing in the time ordered contact list.
+ */
+struct Contact {
+   /** Crossing time (when from arrived) in ticks. */
+   tick_t time;
+   /** Time the other node was there in ticks. */
+   tick_t other;
+   /** Nodes involved (from can pass to to). */
+   int from;
+   int to;
+};
+
 /**
  * Dynamic network that uses real data to drive edge weights.
+ * Once loaded the network is read-only so a single instance can be
+ * shared by any number of simulations running in parallel.
+ * All times are in ticks (see toTicks()); -1 is used for none.
  */
 class DynamicNet {
 private:
    /** Number of nodes in network. */
    int m_size;
+   /** Length of a tick and the time of tick 0 (in the data's units). */
+   double m_tick;
+   double m_epoch;
    /**
     * Lists of the nodes and their delayed crossing times. 
     * List of list of pairs; 1st list has element for each node;
     * 2nd list is for each individual crossing; pair holds
-    * the <crossing time, time other node was there>.
+    * the <crossing time, time other node was there> in ticks.
+    * Each list is sorted by crossing time once loaded.
     */
-   vector< pair<double,double> > **states;
+   vector< vector< pair<tick_t,tick_t> > > states;
+   
+   /** Latest time in each edge's crossings (-1 = none). */
+   vector<tick_t> lastTime;
+   
+   /** Time of the last crossing from each node to any other (-1 = none). */
+   vector<tick_t> lastContact;
    
-   vector< double > *infectedTime;
+   /** Other node times of each edge in order (only built if requested). */
+   vector< vector<tick_t> > ends;
+   
+   /** Every crossing ordered by time (only built if requested). */
+   vector<Contact> timeline;
+   
+   /** Original number of each node and the reverse (empty unless relabelled). */
+   vector<int> labels;
+   vector<int> nodes;
+   
+   /** Compressed crossings, replacing states once built (NULL if not used). */
+   CompressedCrossings<tick_t> *compressed;
+   
+   /** Index of an edge's crossings. */
+   int edge (int from, int to) const { return (m_size * to) + from; }
+   
+   /** Copy of an edge's crossings (in either form). */
+   void getCrossings (int e, vector< pair<tick_t,tick_t> > &out) const {
+      out.clear();
+      if (compressed == NULL) {
+         out = states[e];
+         return;
+      }
+      tick_t l, r;
+      CompressedCrossings<tick_t>::Cursor c = compressed->cursor(e);
+      while (c.next(l, r)) { out.push_back(make_pair(l, r)); }
+   }
+   
+   /** Networks are shared by reference, never copied. */
+   DynamicNet (const DynamicNet &);
+   DynamicNet & operator= (const DynamicNet &);
    
    /** Gets the state crossing vector for a given edge. */
-   vector< pair<double,double> > & getState (int to, int from) {
-      return *states[(m_size * from) + to];
+   vector< pair<tick_t,tick_t> > & getState (int to, int from) {
+      return states[(m_size * from) + to];
+   }
+   const vector< pair<tick_t,tick_t> > & getState (int to, int from) const {
+      return states[(m_size * from) + to];
+   }
+   
+   /** Orders crossings by time so they can be searched. */
+   static bool crossingBefore (const pair<tick_t,tick_t> &a, const pair<tick_t,tick_t> &b) {
+      return a.first < b.first;
+   }
+   static bool timeBefore (tick_t t, const pair<tick_t,tick_t> &a) {
+      return t < a.first;
+   }
+   static bool contactBefore (const Contact &a, const Contact &b) {
+      return a.time < b.time;
    }
      
 public:
    /**
     * Constructor for a dynamic data driven network.
-    * Must supply the number of nodes (size) and a filename to extract
-    * the crossing data from.
+    * Must supply the number of nodes (size) and optionally the length of a
+    * tick and the epoch (time of tick 0) for the data's times. Crossings
+    * are added by a ContactReader (see readers.h) after which index() must
+    * be called.
+    */
+   DynamicNet (int size, double tick = 1.0, double epoch = 0.0) : m_size(size), m_tick(tick), m_epoch(epoch),
+      states(size * size), compressed(NULL) { }
+   
+   ~DynamicNet () { delete compressed; }
+   
+   /** Length of a tick. */
+   double getTick () const { return m_tick; }
+   
+   /**
+    * Converts a time in the data's units to ticks (allowing for rounding in
+    * the input). Returns -1 if the time is before the epoch, too far after
+    * it to be held or not a whole number of ticks, as it would otherwise
+    * be moved silently to a tick.
     */
-   DynamicNet (int size, string filename) { 
-      int i, j, from, to;
-      m_size = size;
-      states = (vector< pair<double,double> > **)malloc(sizeof(vector< pair<double,double> > *) * size * size);
-      for (i = 0; i < (size * size); ++i) {
-            states[i] = new vector< pair<double,double> >();
+   tick_t toTicks (double time) const {
+      double t = floor((time - m_epoch) / m_tick + 0.5);
+      if (t < 0.0 || t > 2147483647.0 || fabs(t * m_tick - (time - m_epoch)) > 1e-6 * m_tick) { return -1; }
+      return (tick_t)t;
+   }
+   
+   /** Converts the length of a timestep to ticks (see stepTicks()). */
+   tick_t stepTicks (double ts) const { return ::stepTicks(ts, m_tick); }
+   
+   /**
+    * Adds a crossing (times in the data's units). Returns false if either
+    * time can not be held in ticks.
+    */
+   bool addUpdate (int from, int to, double fromTime, double toTime) {
+      tick_t l = toTicks(fromTime), r = toTicks(toTime);
+      if (l < 0 || r < 0) { return false; }
+      getState(from, to).push_back(make_pair(l, r));
+      return true;
+   };
+   
+   /**
+    * Append every crossing to a flat buffer (a count then the pairs for
+    * each edge), or add the crossings read back from one, so a loaded
+    * network can be sent between processes. index() must then be called.
+    */
+   void pack (vector<double> &buf) const {
+      vector< pair<tick_t,tick_t> > crossings;
+      for (int i = 0; i < m_size * m_size; ++i) {
+         getCrossings(i, crossings);
+         buf.push_back(crossings.size());
+         for (int k = 0; k < crossings.size(); ++k) {
+            buf.push_back(crossings[k].first);
+            buf.push_back(crossings[k].second);
+         }
       }
-      
-      infectedTime = new vector< double >(size, -1.0);
-
-      ifstream infile(filename.c_str());
-
-      vector <string> record;
-      string none("NA");
-
-      while (infile) {
-         string s;
-         if (!getline(infile, s)) break;
-
-         istringstream ss(s);
-         record.clear();
-
-         while (ss) {
-            string s;
-            if (!getline(ss, s, '\t')) break;
-            record.push_back(s);
+   }
+   void unpack (const vector<double> &buf) {
+      size_t pos = 0;
+      for (int i = 0; i < states.size() && pos < buf.size(); ++i) {
+         int count = (int)buf[pos++];
+         for (int k = 0; k < count; ++k, pos += 2) {
+            states[i].push_back(make_pair((tick_t)buf[pos], (tick_t)buf[pos+1]));
          }
-
-         for (i = 3; i < m_size+3; ++i) {
-            from = atoi(record[2].c_str()) - 1;
-            to = i-3;
-            if (record[i].compare(0, 2, none) != 0) {
-               addUpdate(from, to, atof(record[1].c_str()), atof(record[i].c_str()));
+      }
+   }
+   
+   /**
+    * Sorts the crossings of every edge by time (stable so that crossings
+    * at the same time keep their file order) allowing binary search, and
+    * records the last crossing of each node.
+    */
+   void index () {
+      int from, to;
+      lastTime.assign(states.size(), -1);
+      for (int i = 0; i < states.size(); ++i) {
+         stable_sort(states[i].begin(), states[i].end(), crossingBefore);
+         for (int k = 0; k < states[i].size(); ++k) {
+            lastTime[i] = max(lastTime[i], max(states[i][k].first, states[i][k].second));
+         }
+      }
+      lastContact.assign(m_size, -1);
+      for (from = 0; from < m_size; ++from) {
+         for (to = 0; to < m_size; ++to) {
+            lastContact[from] = max(lastContact[from], getLastCrossing(from, to));
+         }
+      }
+   }
+   
+   /**
+    * Renumbers the nodes so that node order[k] becomes node k, keeping
+    * nodes that interact often close together in memory. Must be called
+    * after index() and before any other index is built or the network is
+    * compressed. Nodes keep their original numbers for input and output
+    * through getLabel() and getNode().
+    */
+   void relabel (const vector<int> &order) {
+      int from, to, k;
+      vector< vector< pair<tick_t,tick_t> > > moved(states.size());
+      for (to = 0; to < m_size; ++to) {
+         for (from = 0; from < m_size; ++from) {
+            moved[edge(from, to)].swap(states[edge(order[from], order[to])]);
+         }
+      }
+      states.swap(moved);
+      vector<int> previous(labels);
+      labels.resize(m_size);
+      nodes.resize(m_size);
+      for (k = 0; k < m_size; ++k) {
+         labels[k] = previous.empty() ? order[k] : previous[order[k]];
+         nodes[labels[k]] = k;
+      }
+      index();
+   }
+   
+   /** Original number of a node, and the node with an original number. */
+   int getLabel (int node) const { return labels.empty() ? node : labels[node]; }
+   int getNode (int label) const { return nodes.empty() ? label : nodes[label]; }
+   
+   /** Original number of every node (empty if the nodes were never relabelled). */
+   const vector<int> & getLabels () const { return labels; }
+   
+   /** Number of crossings from one node to another. */
+   int getCrossingCount (int from, int to) const {
+      return (compressed == NULL) ? getState(from, to).size() : compressed->size(edge(from, to));
+   }
+   
+   /**
+    * Builds the time ordered list of every crossing, used by engines that
+    * step from contact to contact rather than over all pairs. This must be
+    * called before the network is shared between threads.
+    */
+   void indexByTime () {
+      int from, to, k;
+      vector< pair<tick_t,tick_t> > crossings;
+      if (!timeline.empty()) { return; }
+      for (from = 0; from < m_size; ++from) {
+         for (to = 0; to < m_size; ++to) {
+            getCrossings(edge(from, to), crossings);
+            for (k = 0; k < crossings.size(); ++k) {
+               Contact c;
+               c.time = crossings[k].first;
+               c.other = crossings[k].second;
+               c.from = from;
+               c.to = to;
+               timeline.push_back(c);
             }
          }
       }
-
-      if (!infile.eof()) {
-       cerr << "Could not load file.\n";
+      stable_sort(timeline.begin(), timeline.end(), contactBefore);
+   }
+   
+   /**
+    * Builds a sorted list of the other node times of every edge so that
+    * crossings can also be searched by that time (see hasCrossingIn()).
+    * This must be called before the network is shared between threads.
+    */
+   void indexEnds () {
+      vector< pair<tick_t,tick_t> > crossings;
+      if (!ends.empty()) { return; }
+      ends.resize(m_size * m_size);
+      for (int i = 0; i < ends.size(); ++i) {
+         getCrossings(i, crossings);
+         for (int k = 0; k < crossings.size(); ++k) {
+            ends[i].push_back(crossings[k].second);
+         }
+         sort(ends[i].begin(), ends[i].end());
       }
-   };
+   }
    
    /**
-    * Destructor for the dynamic data driven network.
-    * Frees allocated memory.
+    * Replaces the crossing lists with a compressed copy (see compressed.h),
+    * which is typically a few times smaller but slower to search. Must be
+    * called after index() and before the network is shared between threads.
     */
-   ~DynamicNet () { 
-      int i, j;
-      for (i = 0; i < m_size; ++i) {
-         free(states[i]);
+   void compress () {
+      if (compressed != NULL) { return; }
+      compressed = new CompressedCrossings<tick_t>(states);
+      vector< vector< pair<tick_t,tick_t> > >().swap(states);
+   }
+   
+   /** Number of crossings and the bytes used to store them. */
+   size_t countCrossings () const {
+      size_t n = 0;
+      for (int i = 0; i < m_size * m_size; ++i) {
+         n += (compressed == NULL) ? states[i].size() : compressed->size(i);
       }
-      free(states);
-      free(infectedTime);
-   };
+      return n;
+   }
+   size_t crossingBytes () const {
+      if (compressed != NULL) { return compressed->bytes(); }
+      size_t bytes = states.size() * sizeof(states[0]);
+      for (int i = 0; i < states.size(); ++i) {
+         bytes += states[i].capacity() * sizeof(pair<tick_t,tick_t>);
+      }
+      return bytes;
+   }
+   
+   /** Time ordered list of crossings (empty unless indexByTime() has been called). */
+   const vector<Contact> & getTimeline () const { return timeline; }
    
    /**
-    * Adds a crossing.
+    * Time of the last crossing from any node in one set to any node in
+    * another (-1 = none); once past this time the two sets can no longer
+    * interact. The sets are given as predicates on the node number.
     */
-   void addUpdate (int from, int to, double fromTime, double toTime) {
-      // Assumes that input data is sorted in accending time. If not then
-      getState(from, to).push_back(make_pair(fromTime, toTime));
+   template <class FromPred, class ToPred>
+   tick_t getHorizon (FromPred isFrom, ToPred isTo) const {
+      int from, to;
+      tick_t h = -1;
+      for (from = 0; from < m_size; ++from) {
+         // Skip nodes that can't raise the horizon
+         if (!isFrom(from) || lastContact[from] <= h) { continue; }
+         for (to = 0; to < m_size; ++to) {
+            if (isTo(to)) { h = max(h, getLastCrossing(from, to)); }
+         }
+      }
+      return h;
+   }
+   
+   /**
+    * Time of the last crossing between two nodes (-1 = none). This is the
+    * latest of either time so that it also bounds interval data.
+    */
+   tick_t getLastCrossing (int from, int to) const {
+      return lastTime[(m_size * to) + from];
+   }
+   
+   /** Time of the last crossing from a node to any other (-1 = none). */
+   tick_t getLastContact (int from) const { return lastContact[from]; }
+   
+   /**
+    * Calculates the ticks between the last crossing of two nodes.
+    */
+   tick_t getTimeSinceUpdate (int from, int to, tick_t t) const {
+      int crossing;
+      return getTimeSinceUpdate(from, to, t, crossing);
    };
    
    /**
-    * Calculates the timesteps between the last crossing of two nodes.
+    * Calculates the ticks between the last crossing of two nodes.
+    * Also returns the index of the crossing in the edge's (time ordered)
+    * list, which identifies the contact event.
     */
-   double getTimeSinceUpdate (int from, int to, double t) {
-      vector< pair<double,double> >::iterator itr;
-      double firstTime;
-      double l = 0.0, r = 0.0;
-      
-      // Check to ensure there has been a crossing
-      if (getState(from, to).size() == 0) {
-         return -1.0;
+   tick_t getTimeSinceUpdate (int from, int to, tick_t t, int &crossing) const {
+      if (compressed != NULL) {
+         // Decode the block that holds the last crossing at or before t
+         CompressedCrossings<tick_t>::Cursor c = compressed->seekAtOrBefore(edge(from, to), t);
+         tick_t l, r, lastL = -1, lastR = -1;
+         crossing = -1;
+         while (c.next(l, r) && l <= t) {
+            lastL = l;
+            lastR = r;
+            crossing = c.index() - 1;
+         }
+         return (crossing >= 0 && lastL == t) ? t - lastR : -1;
       }
       
-      // Check to see if time is before first crossing
-      firstTime = getState(from, to).at(0).first;
-      if (firstTime > t) {
-         return -1.0;
-      }
-
-      // Find the last crossing before the given time and calculate difference
-      for (itr = getState(from, to).begin(); itr < getState(from, to).end(); ++itr) {
-      	if ((*itr).first > t) { 
-      	   break;
-      	}
-      	else {
-            l = (*itr).first;
-            r = (*itr).second;
-      	}
+      const vector< pair<tick_t,tick_t> > &crossings = getState(from, to);
+      
+      // Find the first crossing after the given time; the one before it
+      // is the last crossing at or before t (if any)
+      vector< pair<tick_t,tick_t> >::const_iterator itr = upper_bound(crossings.begin(), crossings.end(), t, timeBefore);
+      if (itr == crossings.begin()) {
+         return -1;
       }
+      --itr;
+      crossing = itr - crossings.begin();
       
       // Check that crossing is occuring (t == l)
-      if ( t==l ) {
+      if ( t == (*itr).first ) {
          // Return the time to the last crossing
-         return t - r;
+         return t - (*itr).second;
       }
       else {
          // Crossing is not happening at this time point, so ignore.
-         return -1.0;
+         return -1;
       }
    };
    
-   /** Getter and setter for the infected time. */
-   double getInfectedTime (int node) { return infectedTime->at(node); }
-   void setInfectedTime (int node, double time) { infectedTime->at(node) = time; }
+   /**
+    * Checks whether either time of any crossing between two nodes falls
+    * in [t_start, t_end). Also returns an index identifying the crossing
+    * (crossings matched on the other node's time are numbered after those
+    * matched on the crossing time). Requires indexEnds().
+    */
+   bool hasCrossingIn (int from, int to, tick_t t_start, tick_t t_end, int &crossing) const {
+      int count;
+      if (compressed != NULL) {
+         CompressedCrossings<tick_t>::Cursor c = compressed->seekAtOrAfter(edge(from, to), t_start);
+         tick_t l, r;
+         while (c.next(l, r)) {
+            if (l < t_start) { continue; }
+            if (l < t_end) {
+               crossing = c.index() - 1;
+               return true;
+            }
+            break;
+         }
+         count = compressed->size(edge(from, to));
+      }
+      else {
+         const vector< pair<tick_t,tick_t> > &crossings = getState(from, to);
+         vector< pair<tick_t,tick_t> >::const_iterator itr = lower_bound(crossings.begin(), crossings.end(), 
+            make_pair(t_start, (tick_t)0), crossingBefore);
+         if (itr != crossings.end() && (*itr).first < t_end) {
+            crossing = itr - crossings.begin();
+            return true;
+         }
+         count = crossings.size();
+      }
+      const vector<tick_t> &times = ends[edge(from, to)];
+      vector<tick_t>::const_iterator e = lower_bound(times.begin(), times.end(), t_start);
+      if (e != times.end() && *e < t_end) {
+         crossing = count + (e - times.begin());
+         return true;
+      }
+      return false;
+   }
    
    /** Return the number of nodes in the network. */
-   int getSize () { return m_size; }
+   int getSize () const { return m_size; }
 };
 
+#endif // DN_DYNAMIC_NETS_H
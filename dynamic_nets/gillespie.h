@@ -0,0 +1,224 @@
+/*
+ * gillespie.h
+ *
+ * Continuous-time SI spreading over the crossing data using the temporal
+ * Gillespie algorithm (Vestergaard & Genois, 2015). Each crossing is a
+ * contact lasting a fixed duration, during which an infected node passes
+ * on infection at rate SI_RATE * calcWeight(delay, DECAY_RATE). Rather
+ * than stepping through time, the engine jumps from one change in the
+ * total rate (a contact starting or ending) to the next, consuming a
+ * single exponentially distributed waiting time until an infection fires.
+ */
+
+#ifndef DN_GILLESPIE_H
+#define DN_GILLESPIE_H
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <dynamic_nets.h>
+#include <netevo.h>
+
+using namespace std;
+using namespace netevo;
+
+/**
+ * Temporal Gillespie simulator.
+ * Follows the Simulate interface: tMax is in timesteps and observations
+ * are reported in timesteps. The observer sees the state at every output
+ * step (every outFreq steps and tMax) and after every infection, which
+ * may fall between steps.
+ */
+class SimulateTemporalGillespie : public Simulate {
+private:
+   const DynamicNet &m_net;
+   /** Length of a tick (contact times are converted to the data's units). */
+   double m_tick;
+   double m_rate;
+   double m_decayRate;
+   double m_ts;
+   double m_duration;
+   int m_outFreq;
+   bool m_earlyStop;
+   /** Time each node was infected in the current run (-1 = not infected). */
+   vector<double> m_infectedTime;
+   unsigned long m_contacts;
+
+   /** Whether a contact can currently pass on infection. */
+   bool eligible (const Contact &c, const State &x) const {
+      return (x[c.from] == 1.0 && x[c.to] == 0.0 && m_infectedTime[c.from] <= c.other * m_tick);
+   }
+
+   /** Infection rate of a contact. */
+   double rate (const Contact &c) const {
+      return m_rate * calcWeight((c.time - c.other) * m_tick, m_decayRate);
+   }
+
+   /** Time of the last crossing from an infected to a susceptible node (-1 = none). */
+   double horizon (const State &x) const {
+      tick_t h = m_net.getHorizon([&](int i) { return x[i] == 1.0; }, [&](int j) { return x[j] == 0.0; });
+      return (h < 0) ? -1.0 : h * m_tick;
+   }
+   
+   /** Start time of a contact in the data's units. */
+   double start (const Contact &c) const { return c.time * m_tick; }
+
+   /** Observe the state at a given time (in timesteps). */
+   void observe (System &sys, const State &x, double t, SimObserver &obs, ChangeLog &logger) {
+      logger.newState(sys, x);
+      logger.endStep(SIM_STEP);
+      logger.commit();
+      obs(x, t);
+   }
+
+public:
+   SimulateTemporalGillespie (const DynamicNet &net) : m_net(net), m_tick(net.getTick()), m_rate(0.0), m_decayRate(0.0), m_ts(1.0),
+      m_duration(1.0), m_outFreq(1), m_earlyStop(false), m_infectedTime(net.getSize(), -1.0), m_contacts(0) { }
+
+   /**
+    * Set the model parameters: infection rate, decay rate of the crossing
+    * weight, length of a timestep and how long each contact lasts.
+    */
+   void setParams (double rate, double decayRate, double ts, double duration) {
+      m_rate = rate;
+      m_decayRate = decayRate;
+      m_ts = ts;
+      m_duration = duration;
+   }
+
+   /** Output every outFreq timesteps. */
+   void setOutFreq (int outFreq) { m_outFreq = (outFreq > 0) ? outFreq : 1; }
+
+   /** Stop once no further infection is possible (the final state is observed once). */
+   void setEarlyStop (bool earlyStop) { m_earlyStop = earlyStop; }
+
+   /** Running count of contacts processed (used for telemetry). */
+   const unsigned long & contactsEvaluated () { return m_contacts; }
+
+   void simulate (System &sys, double tMax, State &initial, SimObserver &obs, ChangeLog &logger) {
+      const vector<Contact> &contacts = m_net.getTimeline();
+      int i, n = m_net.getSize(), infected = 0;
+      int tEnd = (int)tMax;
+      int nextOut = 0;
+      double tFinal = tEnd * m_ts;
+      double t = 0.0, lambda = 0.0, tau, stopAfter = -1.0;
+      bool stopped = false;
+      State &x = initial;
+
+      if (initial.size() != n) {
+         cerr << "Incorrect number of states for initial conditions (SimulateTemporalGillespie::simulate)" << endl;
+         return;
+      }
+
+      // Nodes infected at the start were infected at time 0
+      for (i=0; i<n; ++i) {
+         m_infectedTime[i] = (x[i] == 1.0) ? 0.0 : -1.0;
+         if (x[i] == 1.0) { ++infected; }
+      }
+      if (m_earlyStop) { stopAfter = horizon(x); }
+
+      // Active contacts are always a window [lo, hi) of the time ordered
+      // list as every contact lasts the same time (ticks are never negative
+      // so this starts with the first contact)
+      size_t lo = 0;
+      size_t hi = lo;
+
+      // Waiting time (in units of integrated rate) to the next infection
+      tau = -log(1.0 - sys.rnd());
+
+      while (true) {
+         // Next change in the total rate, or the end of the simulation
+         double tNext = tFinal;
+         int change = 0;
+         if (lo < hi && start(contacts[lo]) + m_duration <= tNext) {
+            tNext = start(contacts[lo]) + m_duration;
+            change = -1;
+         }
+         // Contacts ending take precedence over those starting at the same time
+         if (hi < contacts.size() && start(contacts[hi]) < tNext) {
+            tNext = start(contacts[hi]);
+            change = 1;
+         }
+
+         if (lambda > 0.0 && tau <= lambda * (tNext - t)) {
+            // Infection occurs before the next change
+            double tInf = t + tau / lambda;
+
+            // Output steps before the infection see the old state
+            while (nextOut <= tEnd && nextOut * m_ts < tInf) {
+               observe(sys, x, nextOut, obs, logger);
+               nextOut = (nextOut == tEnd) ? tEnd + 1 : min(nextOut + m_outFreq, tEnd);
+            }
+            t = tInf;
+
+            // Choose the contact responsible in proportion to its rate
+            double target = sys.rnd() * lambda, sum = 0.0;
+            size_t chosen = hi;
+            for (size_t k=lo; k<hi; ++k) {
+               if (eligible(contacts[k], x)) {
+                  chosen = k;
+                  sum += rate(contacts[k]);
+                  if (sum > target) { break; }
+               }
+            }
+            if (chosen == hi) {
+               // Only reachable through rounding in lambda
+               lambda = 0.0;
+               continue;
+            }
+            int v = contacts[chosen].to;
+            x[v] = 1.0;
+            m_infectedTime[v] = t;
+            ++infected;
+            observe(sys, x, t / m_ts, obs, logger);
+
+            // Recalculate the total rate of the active contacts
+            lambda = 0.0;
+            for (size_t k=lo; k<hi; ++k) {
+               if (eligible(contacts[k], x)) { lambda += rate(contacts[k]); }
+            }
+            tau = -log(1.0 - sys.rnd());
+
+            if (m_earlyStop) {
+               stopAfter = horizon(x);
+               // The state just observed is final
+               if (infected == n) { break; }
+            }
+            continue;
+         }
+
+         // No infection before the next change; use up part of the waiting time
+         tau -= lambda * (tNext - t);
+         while (nextOut <= tEnd && nextOut * m_ts <= tNext) {
+            observe(sys, x, nextOut, obs, logger);
+            nextOut = (nextOut == tEnd) ? tEnd + 1 : min(nextOut + m_outFreq, tEnd);
+         }
+         t = tNext;
+         if (change == 0) { break; }
+
+         if (change < 0) {
+            if (eligible(contacts[lo], x)) { lambda -= rate(contacts[lo]); }
+            ++lo;
+         }
+         else {
+            if (eligible(contacts[hi], x)) { lambda += rate(contacts[hi]); }
+            ++hi;
+         }
+         ++m_contacts;
+         if (lo == hi) { lambda = 0.0; }
+
+         // Nothing can change once past the last useful crossing
+         if (m_earlyStop && lo == hi && t > stopAfter) {
+            stopped = true;
+            break;
+         }
+      }
+
+      // When stopped early the final state is observed once at the stopping time
+      if (stopped && nextOut <= tEnd) {
+         observe(sys, x, t / m_ts, obs, logger);
+      }
+   }
+};
+
+#endif // DN_GILLESPIE_H
@@ -0,0 +1,78 @@
+/*
+ * interactions.h
+ *
+ * Rules deciding whether two nodes interact during a timestep, and how
+ * strongly. SIMap asks the interaction for the weight of every infected
+ * and susceptible pair, so the same engine serves delayed crossing data
+ * and direct interaction data.
+ */
+
+#ifndef DN_INTERACTIONS_H
+#define DN_INTERACTIONS_H
+
+#include <string>
+#include <dynamic_nets.h>
+
+using namespace std;
+
+/**
+ * Base class for an interaction rule.
+ */
+class Interaction {
+public:
+   virtual ~Interaction () { }
+
+   /** Name of the rule. */
+   virtual string getName () = 0;
+
+   /** Prepare any indexes the rule needs (called once the data is loaded). */
+   virtual void prepare (DynamicNet &net) { }
+
+   /**
+    * Weight (in [0, 1]) of the interaction from an infected node to a
+    * susceptible node in the step starting at tick t and lasting ts ticks,
+    * or -1 if there is none. infectedTime is the tick the infected node
+    * became infected at. crossing is set to an index identifying the
+    * contact event. The decay rate is per unit of the data's time.
+    */
+   virtual double weight (const DynamicNet &net, int from, int to, tick_t t, tick_t ts, double decayRate,
+                          tick_t infectedTime, int &crossing) const = 0;
+};
+
+/**
+ * Delayed crossings: a node crossing the path of another at time t can
+ * be infected if the other node was there after it became infected. The
+ * weight decays with the delay between the two (see calcWeight()).
+ */
+class DelayedCrossing : public Interaction {
+public:
+   string getName () { return "delayed"; }
+
+   double weight (const DynamicNet &net, int from, int to, tick_t t, tick_t ts, double decayRate,
+                  tick_t infectedTime, int &crossing) const {
+      tick_t crossTime = net.getTimeSinceUpdate(from, to, t, crossing);
+      // Check that the crossing time occured after the node was infected
+      if (crossTime == -1 || infectedTime == -1 || (t - crossTime) < infectedTime) {
+         return -1.0;
+      }
+      return calcWeight(crossTime * net.getTick(), decayRate);
+   }
+};
+
+/**
+ * Direct interactions: two nodes interact with full weight during a
+ * step if an interaction between them starts or ends within it.
+ */
+class WindowOverlap : public Interaction {
+public:
+   string getName () { return "overlap"; }
+
+   void prepare (DynamicNet &net) { net.indexEnds(); }
+
+   double weight (const DynamicNet &net, int from, int to, tick_t t, tick_t ts, double decayRate,
+                  tick_t infectedTime, int &crossing) const {
+      return net.hasCrossingIn(from, to, t, t + ts, crossing) ? 1.0 : -1.0;
+   }
+};
+
+#endif // DN_INTERACTIONS_H
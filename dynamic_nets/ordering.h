@@ -0,0 +1,111 @@
+/*
+ * ordering.h
+ *
+ * Node orderings for DynamicNet::relabel(). Nodes are numbered as they
+ * appear in the data, so nodes that interact often can be far apart in
+ * the crossing lists. Both orderings work on the aggregated contact graph
+ * (an edge between two nodes if either crosses the other, weighted by the
+ * number of crossings).
+ */
+
+#ifndef DN_ORDERING_H
+#define DN_ORDERING_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <dynamic_nets.h>
+
+using namespace std;
+
+/**
+ * Number of crossings between each pair of nodes in either direction
+ * (n x n, row major).
+ */
+inline vector<int> contactCounts (const DynamicNet &net) {
+   int from, to, n = net.getSize();
+   vector<int> counts(n * n, 0);
+   for (from = 0; from < n; ++from) {
+      for (to = 0; to < n; ++to) {
+         if (from == to) { continue; }
+         counts[(n * from) + to] += net.getCrossingCount(from, to);
+         counts[(n * to) + from] += net.getCrossingCount(from, to);
+      }
+   }
+   return counts;
+}
+
+/**
+ * Nodes in decreasing order of their number of crossings (ties keep the
+ * original order), so the busiest nodes share the start of every list.
+ */
+inline vector<int> degreeOrder (const DynamicNet &net) {
+   int i, j, n = net.getSize();
+   vector<int> counts = contactCounts(net);
+   vector<long> degree(n, 0);
+   vector<int> order(n);
+   for (i = 0; i < n; ++i) {
+      order[i] = i;
+      for (j = 0; j < n; ++j) { degree[i] += counts[(n * i) + j]; }
+   }
+   stable_sort(order.begin(), order.end(), [&](int a, int b) { return degree[a] > degree[b]; });
+   return order;
+}
+
+/**
+ * Reverse Cuthill-McKee order: a breadth first search from a node of
+ * lowest degree in each component, visiting neighbours in increasing
+ * order of degree, then reversed. Nodes in contact end up close together.
+ */
+inline vector<int> rcmOrder (const DynamicNet &net) {
+   int i, j, n = net.getSize();
+   vector<int> counts = contactCounts(net);
+   vector< vector<int> > adj(n);
+   for (i = 0; i < n; ++i) {
+      for (j = 0; j < n; ++j) {
+         if (counts[(n * i) + j] > 0) { adj[i].push_back(j); }
+      }
+   }
+   auto lowerDegree = [&](int a, int b) { return adj[a].size() < adj[b].size(); };
+   for (i = 0; i < n; ++i) {
+      stable_sort(adj[i].begin(), adj[i].end(), lowerDegree);
+   }
+
+   // Components are started from their lowest degree node
+   vector<int> byDegree(n);
+   for (i = 0; i < n; ++i) { byDegree[i] = i; }
+   stable_sort(byDegree.begin(), byDegree.end(), lowerDegree);
+
+   vector<int> order;
+   vector<bool> visited(n, false);
+   order.reserve(n);
+   for (i = 0; i < n; ++i) {
+      if (visited[byDegree[i]]) { continue; }
+      size_t head = order.size();
+      order.push_back(byDegree[i]);
+      visited[byDegree[i]] = true;
+      for (; head < order.size(); ++head) {
+         const vector<int> &next = adj[order[head]];
+         for (j = 0; j < next.size(); ++j) {
+            if (!visited[next[j]]) {
+               visited[next[j]] = true;
+               order.push_back(next[j]);
+            }
+         }
+      }
+   }
+   reverse(order.begin(), order.end());
+   return order;
+}
+
+/**
+ * Ordering by name (degree or rcm). Returns an empty list if the name is
+ * not recognised.
+ */
+inline vector<int> nodeOrder (const DynamicNet &net, const string &name) {
+   if (name == "degree") { return degreeOrder(net); }
+   if (name == "rcm") { return rcmOrder(net); }
+   return vector<int>();
+}
+
+#endif // DN_ORDERING_H
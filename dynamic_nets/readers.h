@@ -0,0 +1,123 @@
+/*
+ * readers.h
+ *
+ * Input formats for the crossing data. Each reader parses one record per
+ * line into crossings on a DynamicNet, so new data formats can be added
+ * without touching the network or the simulation engines.
+ */
+
+#ifndef DN_READERS_H
+#define DN_READERS_H
+
+#include <cstdlib>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <dynamic_nets.h>
+
+using namespace std;
+
+/**
+ * Base class for a reader of crossing data.
+ */
+class ContactReader {
+public:
+   virtual ~ContactReader () { }
+
+   /** Name of the format (used in error messages). */
+   virtual string getName () = 0;
+
+   /**
+    * Add the crossings in a single record (the tab separated fields of a
+    * line) to the network. Returns false if the record is malformed or a
+    * time falls outside the range of the network's ticks.
+    */
+   virtual bool read (const vector<string> &record, DynamicNet &net) = 0;
+
+   /**
+    * Load a file into a network and index it. Returns false if the file
+    * could not be read.
+    */
+   bool load (const string &filename, DynamicNet &net) {
+      ifstream infile(filename.c_str());
+      vector<string> record;
+      int line = 0;
+
+      while (infile) {
+         string s;
+         if (!getline(infile, s)) break;
+         ++line;
+
+         istringstream ss(s);
+         record.clear();
+
+         while (ss) {
+            string s;
+            if (!getline(ss, s, '\t')) break;
+            record.push_back(s);
+         }
+
+         if (!record.empty() && !read(record, net)) {
+            cerr << "Malformed " << getName() << " record (or a time before the epoch or not a whole number"
+                 << " of ticks, see --tick) on line " << line << " of " << filename << ".\n";
+            return false;
+         }
+      }
+
+      if (!infile.eof()) {
+         cerr << "Could not load file.\n";
+         return false;
+      }
+
+      net.index();
+      return true;
+   }
+};
+
+/**
+ * Delayed crossing data. Each line holds a record number, the crossing
+ * time, the node crossing (from 1) and then for every node the time it
+ * was last at the same place (NA if never).
+ */
+class CrossingReader : public ContactReader {
+public:
+   string getName () { return "crossing"; }
+
+   bool read (const vector<string> &record, DynamicNet &net) {
+      int i, from, to;
+      if (record.size() < net.getSize() + 3) { return false; }
+      from = atoi(record[2].c_str()) - 1;
+      if (from < 0 || from >= net.getSize()) { return false; }
+      for (i = 3; i < net.getSize()+3; ++i) {
+         to = i-3;
+         if (record[i].compare(0, 2, "NA") != 0 &&
+             !net.addUpdate(from, to, atof(record[1].c_str()), atof(record[i].c_str()))) {
+            return false;
+         }
+      }
+      return true;
+   }
+};
+
+/**
+ * Direct interaction data. Each line holds the two nodes (from 1) and
+ * the start and end times of an interaction between them. Interactions
+ * are symmetric so are added in both directions.
+ */
+class IntervalReader : public ContactReader {
+public:
+   string getName () { return "interval"; }
+
+   bool read (const vector<string> &record, DynamicNet &net) {
+      if (record.size() < 4) { return false; }
+      int from = atoi(record[0].c_str()) - 1;
+      int to = atoi(record[1].c_str()) - 1;
+      if (from < 0 || from >= net.getSize() || to < 0 || to >= net.getSize()) { return false; }
+      return net.addUpdate(from, to, atof(record[2].c_str()), atof(record[3].c_str())) &&
+             net.addUpdate(to, from, atof(record[2].c_str()), atof(record[3].c_str()));
+   }
+};
+
+#endif // DN_READERS_H
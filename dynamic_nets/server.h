@@ -0,0 +1,238 @@
+/*
+ * server.h
+ *
+ * Binary protocol and Unix domain socket handling for the server mode.
+ * A server loads its data sets once and then answers any number of
+ * simulation requests, so a query costs only the simulation itself.
+ *
+ * All values are in the host's byte order (the socket is local). A
+ * connection may carry any number of requests, each answered in turn.
+ *
+ * Request:
+ *   uint32 magic        SERVER_REQUEST_MAGIC
+ *   uint32 dataset      index of the data set (in the order loaded)
+ *   uint32 ant          ant to start infected (from 1, 0 = all)
+ *   uint32 runs         runs per ant (at most 2^31 - 1)
+ *   uint32 len          timesteps per simulation (at most 2^31 - 2)
+ *   uint32 outFreq      summary curve frequency (timesteps); the curve
+ *                       rows times the ants may be at most SERVER_MAX_CURVE
+ *   uint32 flags        SERVER_FLAG_* bits
+ *   double probSI, decayRate, ts, contactDuration (0 = ts)
+ *   uint64 seed         0 = unseeded, otherwise runs are reproducible
+ *
+ * Response:
+ *   uint32 magic        SERVER_RESPONSE_MAGIC
+ *   uint32 status       0 = ok, otherwise an error follows:
+ *     uint32 length, char message[length]
+ *   uint32 nodes, rows, ants
+ *   double time[rows]
+ *   for each ant:
+ *     uint32 ant, runs
+ *     double final mean, final variance
+ *     int32  final quantiles[SUMMARY_NUM_QUANTILES]
+ *     double curve mean[rows], curve variance[rows]
+ *     double infection probability[nodes]
+ */
+
+#ifndef DN_SERVER_H
+#define DN_SERVER_H
+
+#include <stdint.h>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <climits>
+#include <aggregate.h>
+
+using namespace std;
+
+static const uint32_t SERVER_REQUEST_MAGIC = 0x31514e44;  // "DNQ1"
+static const uint32_t SERVER_RESPONSE_MAGIC = 0x31524e44; // "DNR1"
+
+/** Request flags. */
+static const uint32_t SERVER_FLAG_GILLESPIE = 1;
+static const uint32_t SERVER_FLAG_CRN = 2;
+static const uint32_t SERVER_FLAG_SHUTDOWN = 4;
+
+/** Largest curve (rows times ants) a request may ask for, as each is held in memory. */
+static const long SERVER_MAX_CURVE = 250000;
+
+/**
+ * A simulation request.
+ */
+struct ServerRequest {
+   uint32_t dataset;
+   uint32_t ant;
+   uint32_t runs;
+   uint32_t len;
+   uint32_t outFreq;
+   uint32_t flags;
+   double probSI;
+   double decayRate;
+   double ts;
+   double contactDuration;
+   uint64_t seed;
+};
+
+/**
+ * Reads and writes whole values on a connected socket.
+ */
+class ServerConnection {
+private:
+   int m_fd;
+   /** Response being built (sent in a single write). */
+   string m_out;
+
+   bool readFully (void *buf, size_t len) {
+      char *p = (char *)buf;
+      while (len > 0) {
+         ssize_t n = ::read(m_fd, p, len);
+         if (n < 0 && errno == EINTR) { continue; }
+         if (n <= 0) { return false; }
+         p += n;
+         len -= n;
+      }
+      return true;
+   }
+
+   template <class T> bool get (T &value) { return readFully(&value, sizeof(T)); }
+
+public:
+   ServerConnection (int fd) : m_fd(fd) { }
+   ~ServerConnection () { ::close(m_fd); }
+
+   /** Read the next request. Returns false at the end of the connection or on a bad request. */
+   bool readRequest (ServerRequest &req) {
+      uint32_t magic;
+      if (!get(magic) || magic != SERVER_REQUEST_MAGIC) { return false; }
+      return get(req.dataset) && get(req.ant) && get(req.runs) && get(req.len) && get(req.outFreq) &&
+             get(req.flags) && get(req.probSI) && get(req.decayRate) && get(req.ts) &&
+             get(req.contactDuration) && get(req.seed);
+   }
+
+   /** Append a value to the response. */
+   template <class T> void put (const T &value) { m_out.append((const char *)&value, sizeof(T)); }
+
+   /**
+    * Send the response built so far. Returns false if the client has gone
+    * (the server ignores SIGPIPE so this only ends the connection).
+    */
+   bool flush () {
+      const char *p = m_out.data();
+      size_t len = m_out.size();
+      while (len > 0) {
+         ssize_t n = ::write(m_fd, p, len);
+         if (n < 0 && errno == EINTR) { continue; }
+         if (n <= 0) { m_out.clear(); return false; }
+         p += n;
+         len -= n;
+      }
+      m_out.clear();
+      return true;
+   }
+
+   /** Send an error response. */
+   bool sendError (const string &message) {
+      put(SERVER_RESPONSE_MAGIC);
+      put((uint32_t)1);
+      put((uint32_t)message.size());
+      m_out.append(message);
+      return flush();
+   }
+
+   /** Send the aggregated results of a request (one aggregate per ant). */
+   bool sendResults (const vector<int> &ants, vector<RunAggregate *> &aggregates, int nodes, double ts) {
+      int a, i, q;
+      const vector<int> &rowSteps = aggregates[0]->rowSteps();
+      put(SERVER_RESPONSE_MAGIC);
+      put((uint32_t)0);
+      put((uint32_t)nodes);
+      put((uint32_t)rowSteps.size());
+      put((uint32_t)ants.size());
+      for (i=0; i<rowSteps.size(); ++i) {
+         put((double)(rowSteps[i] * ts));
+      }
+      for (a=0; a<ants.size(); ++a) {
+         RunAggregate &agg = *aggregates[a];
+         put((uint32_t)(ants[a] + 1));
+         put((uint32_t)agg.runs());
+         put(agg.finalSize().mean);
+         put(agg.finalSize().variance());
+         for (q=0; q<SUMMARY_NUM_QUANTILES; ++q) {
+            put((int32_t)agg.finalSizeSketch().quantile(SUMMARY_QUANTILES[q]));
+         }
+         for (i=0; i<rowSteps.size(); ++i) {
+            put(agg.curve()[i].mean);
+         }
+         for (i=0; i<rowSteps.size(); ++i) {
+            put(agg.curve()[i].variance());
+         }
+         for (i=0; i<nodes; ++i) {
+            put(agg.runs() > 0 ? (double)agg.nodeInfected()[i] / agg.runs() : 0.0);
+         }
+      }
+      return flush();
+   }
+};
+
+/**
+ * Listening Unix domain socket. The socket file is removed when the
+ * server is destroyed.
+ */
+class Server {
+private:
+   string m_path;
+   int m_fd;
+
+public:
+   Server (const string &path) : m_path(path), m_fd(-1) { }
+   ~Server () {
+      if (m_fd >= 0) {
+         ::close(m_fd);
+         ::unlink(m_path.c_str());
+      }
+   }
+
+   /** Create the socket and start listening. Returns false on failure. */
+   bool listen () {
+      struct sockaddr_un addr;
+      if (m_path.size() >= sizeof(addr.sun_path)) {
+         cerr << "Error: socket path too long." << endl;
+         return false;
+      }
+      memset(&addr, 0, sizeof(addr));
+      addr.sun_family = AF_UNIX;
+      strcpy(addr.sun_path, m_path.c_str());
+      m_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+      if (m_fd < 0) {
+         cerr << "Error: could not create socket (" << strerror(errno) << ")." << endl;
+         return false;
+      }
+      // Replace a socket left by a previous server
+      ::unlink(m_path.c_str());
+      if (::bind(m_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || ::listen(m_fd, 16) < 0) {
+         cerr << "Error: could not listen on " << m_path << " (" << strerror(errno) << ")." << endl;
+         ::close(m_fd);
+         m_fd = -1;
+         return false;
+      }
+      return true;
+   }
+
+   /** Wait for the next connection (-1 on failure). */
+   int accept () {
+      int fd;
+      do {
+         fd = ::accept(m_fd, NULL, NULL);
+      } while (fd < 0 && errno == EINTR);
+      return fd;
+   }
+};
+
+#endif // DN_SERVER_H
@@ -0,0 +1,150 @@
+/*
+ * snapshots.h
+ *
+ * Aggregated snapshots of the crossing data as NetEvo Systems, so the
+ * static tools (eigenvalues, components, the ODE simulators) can be run
+ * on windows of the data. A window slides over the time ordered contact
+ * list and the System is updated in place: only the crossings entering
+ * and leaving the window are touched, and arcs are added and erased as
+ * pairs gain their first crossing or lose their last.
+ */
+
+#ifndef DN_SNAPSHOTS_H
+#define DN_SNAPSHOTS_H
+
+#include <cstdio>
+#include <vector>
+#include <dynamic_nets.h>
+#include <netevo.h>
+
+using namespace std;
+using namespace netevo;
+
+/** How arc weights are formed from the crossings in a window. */
+enum snapshot_weight_e {
+   /** Number of crossings. */
+   SNAPSHOT_COUNT = 0,
+   /** Sum of calcWeight(age, DECAY_RATE) with the age measured from the end of the window. */
+   SNAPSHOT_DECAY = 1
+};
+
+/**
+ * Builds a sequence of weighted Systems over windows [start, start +
+ * window) that advance by a fixed step. The System has a node for every
+ * node of the network (named by its number in the data) and an arc from
+ * one node to another whenever the first crosses the second in the
+ * window. Reads the time ordered contacts, so DynamicNet::indexByTime()
+ * must have been called.
+ */
+class SnapshotBuilder {
+private:
+   const DynamicNet &m_net;
+   System &m_sys;
+   /** Window length and step in ticks. */
+   tick_t m_window;
+   tick_t m_step;
+   snapshot_weight_e m_weights;
+   double m_decayRate;
+
+   /** Node of the System for each node of the network. */
+   vector<Node> m_nodes;
+   /** Arc (INVALID if none) and crossings in the window of each pair. */
+   vector<Arc> m_arcs;
+   vector<int> m_counts;
+   /** Window start and the contacts entering and leaving it next. */
+   tick_t m_start;
+   size_t m_enter;
+   size_t m_leave;
+   bool m_started;
+
+   int edge (const Contact &c) const { return (m_net.getSize() * c.to) + c.from; }
+
+   /** Weight a crossing adds to its arc in the current window. */
+   double contribution (const Contact &c) const {
+      if (m_weights == SNAPSHOT_COUNT) { return 1.0; }
+      return calcWeight((m_start + m_window - 1 - c.time) * m_net.getTick(), m_decayRate);
+   }
+
+   void enter (const Contact &c) {
+      int e = edge(c);
+      if (c.from == c.to) { return; }
+      if (m_counts[e]++ == 0) {
+         m_arcs[e] = m_sys.addArc(m_nodes[c.from], m_nodes[c.to]);
+         m_sys.setArcWeight(m_arcs[e], 0.0);
+      }
+      m_sys.setArcWeight(m_arcs[e], m_sys.arcData(m_arcs[e]).weight + contribution(c));
+   }
+
+   void leave (const Contact &c) {
+      int e = edge(c);
+      if (c.from == c.to) { return; }
+      if (--m_counts[e] == 0) {
+         m_sys.erase(m_arcs[e]);
+         m_arcs[e] = INVALID;
+         return;
+      }
+      m_sys.setArcWeight(m_arcs[e], m_sys.arcData(m_arcs[e]).weight - contribution(c));
+   }
+
+public:
+   /**
+    * Constructor. The System must be empty; window and step are in the
+    * data's units and must be whole numbers of ticks (see valid()).
+    */
+   SnapshotBuilder (const DynamicNet &net, System &sys, double window, double step,
+                    snapshot_weight_e weights = SNAPSHOT_COUNT, double decayRate = 0.0) :
+      m_net(net), m_sys(sys), m_window(net.stepTicks(window)), m_step(net.stepTicks(step)), m_weights(weights),
+      m_decayRate(decayRate), m_arcs(net.getSize() * net.getSize(), INVALID),
+      m_counts(net.getSize() * net.getSize(), 0), m_start(0), m_enter(0), m_leave(0), m_started(false) {
+      char name[32];
+      for (int i = 0; i < net.getSize(); ++i) {
+         sprintf(name, "%i", net.getLabel(i) + 1);
+         m_nodes.push_back(m_sys.addNode(name, "NoNodeDynamic"));
+      }
+   }
+
+   /** Whether the window and step are whole numbers of ticks. */
+   bool valid () const { return m_window > 0 && m_step > 0; }
+
+   /** Start and end of the current window (in ticks). */
+   tick_t start () const { return m_start; }
+   tick_t end () const { return m_start + m_window; }
+
+   /**
+    * Move to the next window (the first call builds the window starting
+    * at tick 0). Returns false once the window starts after the last
+    * crossing, leaving the System as it was.
+    */
+   bool next () {
+      const vector<Contact> &contacts = m_net.getTimeline();
+      if (!valid()) { return false; }
+      tick_t start = m_started ? m_start + m_step : 0;
+      if (contacts.empty() || start > contacts.back().time) { return false; }
+
+      // Crossings leaving the window lose the weight they were given in it
+      for (; m_leave < m_enter && contacts[m_leave].time < start; ++m_leave) {
+         leave(contacts[m_leave]);
+      }
+      // Decayed weights age by the step; counts are unchanged
+      if (m_weights == SNAPSHOT_DECAY && m_started) {
+         double factor = calcWeight((start - m_start) * m_net.getTick(), m_decayRate);
+         for (System::ArcIt a(m_sys); a != INVALID; ++a) {
+            m_sys.setArcWeight(a, m_sys.arcData(a).weight * factor);
+         }
+      }
+      m_start = start;
+      m_started = true;
+      // A step longer than the window skips crossings that are never in one
+      if (m_leave == m_enter) {
+         while (m_enter < contacts.size() && contacts[m_enter].time < start) { ++m_enter; }
+         m_leave = m_enter;
+      }
+      for (; m_enter < contacts.size() && contacts[m_enter].time < end(); ++m_enter) {
+         enter(contacts[m_enter]);
+      }
+      m_sys.refreshStateIDs();
+      return true;
+   }
+};
+
+#endif // DN_SNAPSHOTS_H
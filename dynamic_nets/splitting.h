@@ -0,0 +1,84 @@
+/*
+ * splitting.h
+ *
+ * Multilevel splitting for the probability of large outbreaks. Plain
+ * runs rarely reach a large size when infection is unlikely, so instead
+ * the runs reaching an intermediate infected count are saved and cloned
+ * to start the next stage. The probability of reaching the final level
+ * is the product of the fraction of trials reaching each level from the
+ * one before, which is an unbiased estimate that needs far fewer steps.
+ */
+
+#ifndef DN_SPLITTING_H
+#define DN_SPLITTING_H
+
+#include <cmath>
+#include <vector>
+#include <dynamic_nets.h>
+#include <netevo.h>
+
+using namespace std;
+using namespace netevo;
+
+/**
+ * A partial run: the state after step t and the infection times the SI
+ * dynamics need to continue it.
+ */
+struct SplitState {
+   int t;
+   State x;
+   vector<tick_t> infectedTime;
+};
+
+/**
+ * Fixed effort splitting estimate. Every stage runs the same number of
+ * trials, started evenly from the states saved at the previous level, and
+ * records how many reach the next level.
+ */
+class SplitEstimate {
+private:
+   vector<int> m_levels;
+   vector<long> m_trials;
+   vector<long> m_hits;
+
+public:
+   /** Record a stage: trials started at the previous level and how many reached level. */
+   void addLevel (int level, long trials, long hits) {
+      m_levels.push_back(level);
+      m_trials.push_back(trials);
+      m_hits.push_back(hits);
+   }
+
+   /** Number of stages recorded. */
+   int stages () const { return m_levels.size(); }
+
+   int level (int k) const { return m_levels[k]; }
+   long trials (int k) const { return m_trials[k]; }
+   long hits (int k) const { return m_hits[k]; }
+
+   /** Estimated probability of reaching the level of stage k. */
+   double prob (int k) const {
+      double p = 1.0;
+      for (int i = 0; i <= k; ++i) {
+         p *= (m_trials[i] > 0) ? (double)m_hits[i] / m_trials[i] : 0.0;
+      }
+      return p;
+   }
+
+   /**
+    * Approximate relative error of prob(k), treating the stages as
+    * independent: sqrt(sum (1 - p_i) / (N_i p_i)). Infinite if a stage
+    * had no hits.
+    */
+   double relativeError (int k) const {
+      double sum = 0.0;
+      for (int i = 0; i <= k; ++i) {
+         if (m_hits[i] == 0) { return HUGE_VAL; }
+         double p = (double)m_hits[i] / m_trials[i];
+         sum += (1.0 - p) / (m_trials[i] * p);
+      }
+      return sqrt(sum);
+   }
+};
+
+#endif // DN_SPLITTING_H
@@ -0,0 +1,129 @@
+/*
+ * sweep.h
+ *
+ * Parameter grids and ordered output for running many simulations
+ * over a single loaded data set.
+ */
+
+#ifndef DN_SWEEP_H
+#define DN_SWEEP_H
+
+#include <cstdlib>
+#include <cstdio>
+#include <vector>
+#include <map>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <mutex>
+
+using namespace std;
+
+/**
+ * A single point in the parameter grid.
+ */
+struct SweepPoint {
+   double probSI;
+   double decayRate;
+   double ts;
+};
+
+/**
+ * Parse a list of values. Accepts comma separated values and ranges of
+ * the form start:step:end (inclusive), e.g. "0.1,0.2" or "0.1:0.1:0.5".
+ * Returns no values if a range does not have exactly three fields or a
+ * positive step.
+ */
+inline vector<double> parseValues (const string &spec) {
+   vector<double> values;
+   istringstream ss(spec);
+   string item;
+   while (getline(ss, item, ',')) {
+      size_t c1 = item.find(':');
+      if (c1 == string::npos) {
+         values.push_back(atof(item.c_str()));
+         continue;
+      }
+      size_t c2 = item.find(':', c1+1);
+      if (c2 == string::npos || item.find(':', c2+1) != string::npos) {
+         return vector<double>();
+      }
+      double start = atof(item.substr(0, c1).c_str());
+      double step = atof(item.substr(c1+1, c2-c1-1).c_str());
+      double end = atof(item.substr(c2+1).c_str());
+      if (step <= 0.0) {
+         return vector<double>();
+      }
+      // Count the steps to avoid accumulating rounding errors
+      int n = (int)((end - start) / step + 1e-9);
+      for (int i=0; i<=n; ++i) {
+         values.push_back(start + i * step);
+      }
+   }
+   return values;
+}
+
+/**
+ * Build the full grid of parameter points (SI_PROB varies fastest).
+ */
+inline vector<SweepPoint> buildGrid (const vector<double> &probs, const vector<double> &decays, const vector<double> &tss) {
+   vector<SweepPoint> grid;
+   int i, j, k;
+   for (k=0; k<tss.size(); ++k) {
+      for (j=0; j<decays.size(); ++j) {
+         for (i=0; i<probs.size(); ++i) {
+            SweepPoint p;
+            p.probSI = probs[i];
+            p.decayRate = decays[j];
+            p.ts = tss[k];
+            grid.push_back(p);
+         }
+      }
+   }
+   return grid;
+}
+
+/**
+ * Output file for the runs of one (parameter point, ant) pair.
+ * Runs can complete out of order on different threads; they are buffered
+ * only until all earlier runs have been written, so the file is identical
+ * to a serial run. The file is opened on first use and closed once every
+ * run has been written to keep the number of open files small.
+ */
+class OrderedOutput {
+private:
+   mutex m_mutex;
+   string m_filename;
+   ofstream m_file;
+   int m_runs;
+   int m_next;
+   map<int, string> m_pending;
+public:
+   OrderedOutput (const string &filename, int runs) : m_filename(filename), m_runs(runs), m_next(0) { }
+
+   /** Submit the formatted output of a run. */
+   void submit (int run, string &data) {
+      lock_guard<mutex> lock(m_mutex);
+      if (run != m_next) {
+         m_pending[run].swap(data);
+         return;
+      }
+      if (!m_file.is_open()) {
+         m_file.open(m_filename.c_str());
+      }
+      m_file << data;
+      ++m_next;
+      // Flush any runs that were waiting on this one
+      map<int, string>::iterator itr = m_pending.begin();
+      while (itr != m_pending.end() && itr->first == m_next) {
+         m_file << itr->second;
+         m_pending.erase(itr++);
+         ++m_next;
+      }
+      if (m_next == m_runs) {
+         m_file.close();
+      }
+   }
+};
+
+#endif // DN_SWEEP_H
@@ -0,0 +1,203 @@
+/*
+ * telemetry.h
+ *
+ * Periodic progress and throughput reporting for long simulation runs.
+ * Counters are plain atomics updated from the simulation threads; a
+ * separate low-priority thread samples them and writes one line of
+ * whitespace separated key=value pairs per interval.
+ */
+
+#ifndef DN_TELEMETRY_H
+#define DN_TELEMETRY_H
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <iostream>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include <netevo.h>
+
+using namespace std;
+using namespace netevo;
+
+/**
+ * Telemetry reporter.
+ * Holds the shared counters and owns the reporting thread. All counter
+ * updates use relaxed atomics so the cost on the simulation side is a
+ * single atomic add.
+ */
+class Telemetry {
+private:
+   /** Counters updated by the simulation threads. */
+   atomic<unsigned long> m_runs;
+   atomic<unsigned long> m_steps;
+   atomic<unsigned long> m_contacts;
+   /** Total number of runs expected (used for the ETA). */
+   unsigned long m_totalRuns;
+   /** Reporting interval in seconds. */
+   double m_interval;
+   /** Stream the telemetry lines are written to. */
+   ostream &m_out;
+
+   thread m_thread;
+   mutex m_mutex;
+   condition_variable m_wake;
+   bool m_stop;
+
+   chrono::steady_clock::time_point m_start;
+   chrono::steady_clock::time_point m_lastTime;
+   unsigned long m_lastSteps;
+   unsigned long m_lastContacts;
+
+   /** Peak resident set size of the process in kilobytes. */
+   static long maxRSSKB () {
+      struct rusage usage;
+      if (getrusage(RUSAGE_SELF, &usage) != 0) {
+         return -1;
+      }
+#ifdef __APPLE__
+      // Reported in bytes on OS X
+      return usage.ru_maxrss / 1024;
+#else
+      return usage.ru_maxrss;
+#endif
+   }
+
+   /** Write a single telemetry line. Rates are for the period since the last line. */
+   void report (bool final) {
+      chrono::steady_clock::time_point now = chrono::steady_clock::now();
+      double elapsed = chrono::duration<double>(now - m_start).count();
+      double period = chrono::duration<double>(now - m_lastTime).count();
+      unsigned long runs = m_runs.load(memory_order_relaxed);
+      unsigned long steps = m_steps.load(memory_order_relaxed);
+      unsigned long contacts = m_contacts.load(memory_order_relaxed);
+      double stepRate = 0.0, contactRate = 0.0, eta = -1.0;
+
+      if (period > 0.0) {
+         stepRate = (steps - m_lastSteps) / period;
+         contactRate = (contacts - m_lastContacts) / period;
+      }
+
+      // Estimate remaining time from the average run rate so far
+      if (runs > 0 && m_totalRuns >= runs) {
+         eta = elapsed * (double)(m_totalRuns - runs) / (double)runs;
+      }
+
+      m_out << "TELEMETRY"
+            << " elapsed_s=" << elapsed
+            << " runs=" << runs
+            << " runs_total=" << m_totalRuns
+            << " steps=" << steps
+            << " steps_per_s=" << stepRate
+            << " contacts=" << contacts
+            << " contacts_per_s=" << contactRate
+            << " eta_s=" << eta
+            << " maxrss_kb=" << maxRSSKB()
+            << " final=" << (final ? 1 : 0) << endl;
+
+      m_lastTime = now;
+      m_lastSteps = steps;
+      m_lastContacts = contacts;
+   }
+
+   /** Body of the reporting thread. */
+   void reporter () {
+#ifdef __linux__
+      // Lower the priority of this thread only so it never competes with the simulation
+      setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 19);
+#endif
+      unique_lock<mutex> lock(m_mutex);
+      while (!m_stop) {
+         m_wake.wait_for(lock, chrono::duration<double>(m_interval));
+         if (!m_stop) {
+            report(false);
+         }
+      }
+   }
+
+public:
+   /**
+    * Constructor for the reporter.
+    * Must supply the total number of runs expected, the reporting interval
+    * (seconds) and the stream to write to.
+    */
+   Telemetry (unsigned long totalRuns, double interval, ostream &out) : m_runs(0), m_steps(0),
+      m_contacts(0), m_totalRuns(totalRuns), m_interval(interval), m_out(out), m_stop(true),
+      m_lastSteps(0), m_lastContacts(0) {
+      m_start = chrono::steady_clock::now();
+      m_lastTime = m_start;
+   }
+
+   /** Destructor ensures the reporting thread has been joined. */
+   ~Telemetry () { stop(); }
+
+   /** Start the reporting thread. */
+   void start () {
+      if (m_thread.joinable()) {
+         return;
+      }
+      m_stop = false;
+      m_start = chrono::steady_clock::now();
+      m_lastTime = m_start;
+      m_thread = thread(&Telemetry::reporter, this);
+   }
+
+   /** Stop the reporting thread and write a final line. */
+   void stop () {
+      if (!m_thread.joinable()) {
+         return;
+      }
+      {
+         lock_guard<mutex> lock(m_mutex);
+         m_stop = true;
+      }
+      m_wake.notify_all();
+      m_thread.join();
+      report(true);
+   }
+
+   /** Record a completed simulation step and the contacts evaluated during it. */
+   void addStep (unsigned long contacts) {
+      m_steps.fetch_add(1, memory_order_relaxed);
+      if (contacts > 0) {
+         m_contacts.fetch_add(contacts, memory_order_relaxed);
+      }
+   }
+
+   /** Record a completed run. */
+   void addRun () { m_runs.fetch_add(1, memory_order_relaxed); }
+};
+
+/**
+ * Observer that feeds a Telemetry reporter.
+ * Passes every observation on to another observer so it can be placed in
+ * front of the existing output observers. The number of contacts evaluated
+ * is read from a counter maintained by the dynamics.
+ */
+class SimObserverTelemetry : public SimObserver {
+private:
+   Telemetry &m_tel;
+   SimObserver &m_obs;
+   const unsigned long &m_contacts;
+   unsigned long m_last;
+public:
+   SimObserverTelemetry (Telemetry &tel, SimObserver &obs, const unsigned long &contacts) : m_tel(tel),
+      m_obs(obs), m_contacts(contacts), m_last(contacts) { }
+
+   void operator() (const State &x, double t) {
+      // Initial conditions are not a simulated step
+      if (t > 0.0) {
+         m_tel.addStep(m_contacts - m_last);
+      }
+      m_last = m_contacts;
+      m_obs(x, t);
+   }
+};
+
+#endif // DN_TELEMETRY_H
@@ -0,0 +1,125 @@
+/*
+ * check_aggregate.cc
+ *
+ * Checks the online statistics of aggregate.h: Welford means and
+ * variances against a two pass calculation, sketch quantiles against the
+ * sorted values (exact, and at most a bin width high when the bins are
+ * limited), and that aggregates of runs split between threads or
+ * processes, once merged or sent through a buffer, give the same summary
+ * as a single aggregate of every run. Built and run by compile.sh; prints
+ * "ok" or the first problem and fails.
+ */
+
+#include <cmath>
+#include <vector>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <aggregate.h>
+
+using namespace std;
+
+static uint64_t x = 2463534242ULL;
+
+/** Pseudo-random integer in [0, n). */
+int draw (int n) {
+   x ^= x << 13;
+   x ^= x >> 7;
+   x ^= x << 17;
+   return (int)(x % n);
+}
+
+/** Equal up to rounding. */
+bool approxEqual (double a, double b) { return fabs(a - b) <= 1e-9 * max(1.0, fabs(b)); }
+
+/** Fill a trace with a random run: nodes are infected one by one at increasing steps. */
+void randomRun (SimObserverRunTrace &trace, int nodes, int len) {
+   State state(nodes, 0.0);
+   trace.reset();
+   state[draw(nodes)] = 1.0;
+   trace(state, 0.0);
+   for (int t = 1; t <= len; ++t) {
+      if (draw(4) == 0) { state[draw(nodes)] = 1.0; }
+      trace(state, (double)t);
+      // Some runs stop early (the rest of their rows keep the last state)
+      if (draw(200) == 0) { break; }
+   }
+}
+
+int main (int argc, char **argv) {
+   int i, k;
+
+   // Welford, merged from two uneven parts
+   vector<double> values;
+   Welford all, left, right, empty;
+   for (i = 0; i < 1000; ++i) {
+      values.push_back(1e6 + draw(1000) / 7.0);
+      all.add(values[i]);
+      (i < 300 ? left : right).add(values[i]);
+   }
+   double mean = 0.0, ss = 0.0;
+   for (i = 0; i < values.size(); ++i) { mean += values[i] / values.size(); }
+   for (i = 0; i < values.size(); ++i) { ss += (values[i] - mean) * (values[i] - mean); }
+   left.merge(right);
+   left.merge(empty);
+   if (!approxEqual(all.mean, mean) || !approxEqual(all.variance(), ss / (values.size() - 1)) || left.n != all.n ||
+       !approxEqual(left.mean, all.mean) || !approxEqual(left.variance(), all.variance())) {
+      cerr << "check_aggregate: Welford mean or variance is wrong." << endl;
+      return 1;
+   }
+
+   // Sketches, exact and with limited bins, merged from two parts
+   int maxValue = 1000;
+   vector<int> counts;
+   CountSketch exact(maxValue), part1(maxValue), part2(maxValue), binned(maxValue, 64);
+   for (i = 0; i < 5000; ++i) {
+      counts.push_back(draw(maxValue + 1));
+      (i % 3 == 0 ? part1 : part2).add(counts[i]);
+      exact.add(counts[i]);
+      binned.add(counts[i]);
+   }
+   part1.merge(part2);
+   sort(counts.begin(), counts.end());
+   for (k = 0; k < SUMMARY_NUM_QUANTILES; ++k) {
+      double q = SUMMARY_QUANTILES[k];
+      int truth = counts[(int)ceil(q * counts.size()) - 1];
+      if (exact.quantile(q) != truth || part1.quantile(q) != truth || binned.quantile(q) < truth ||
+          binned.quantile(q) > truth + binned.width - 1) {
+         cerr << "check_aggregate: quantile " << q << " is " << exact.quantile(q) << " (merged " << part1.quantile(q)
+              << ", binned " << binned.quantile(q) << ") not " << truth << "." << endl;
+         return 1;
+      }
+   }
+
+   // Runs split over two aggregates then merged, and sent through a buffer
+   int nodes = 20, len = 300;
+   vector<int> rowSteps = outputSteps(len, 10);
+   vector<double> fractions;
+   fractions.push_back(0.1);
+   fractions.push_back(0.5);
+   RunAggregate single(nodes, rowSteps, fractions), first(nodes, rowSteps, fractions),
+                second(nodes, rowSteps, fractions), sent(nodes, rowSteps, fractions);
+   SimObserverRunTrace trace(rowSteps, nodes);
+   for (i = 0; i < 200; ++i) {
+      randomRun(trace, nodes, len);
+      single.add(trace);
+      (draw(2) == 0 ? first : second).add(trace);
+   }
+   first.merge(second);
+   vector<double> buf;
+   first.pack(buf);
+   const double *p = buf.data();
+   sent.unpack(p);
+
+   ostringstream expected, merged, unpacked;
+   single.write(expected, 1, 1, 1.0);
+   first.write(merged, 1, 1, 1.0);
+   sent.write(unpacked, 1, 1, 1.0);
+   if (first.runs() != 200 || sent.runs() != 200 || p != buf.data() + buf.size() ||
+       merged.str() != expected.str() || unpacked.str() != expected.str()) {
+      cerr << "check_aggregate: merged or unpacked aggregates differ from a single one." << endl;
+      return 1;
+   }
+   cout << "ok" << endl;
+   return 0;
+}
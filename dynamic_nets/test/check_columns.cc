@@ -0,0 +1,77 @@
+/*
+ * check_columns.cc
+ *
+ * Checks that rows written to a columnar store (see columns.h) in any
+ * order read back unchanged through ColumnStore, with never infected
+ * nodes as -1, and that a store of the wrong size is rejected. Built and
+ * run by compile.sh; prints "ok" or the first problem and fails.
+ */
+
+#include <cstdio>
+#include <vector>
+#include <iostream>
+#include <columns.h>
+
+using namespace std;
+
+static const char *FILENAME = "check_columns.dnt";
+
+/** Step a node was infected at in a row (-1 = never). */
+int infectedStep (uint64_t row, uint32_t node) {
+   return ((row + node) % 3 == 0) ? -1 : (int)(row * 2 + node);
+}
+
+int main (int argc, char **argv) {
+   uint32_t nodes = 5;
+   uint64_t rows = 13;
+   double ts = 0.5;
+
+   // Write the rows backwards (threads may finish them in any order)
+   {
+      ColumnWriter writer(FILENAME, nodes, rows);
+      if (!writer.isOpen()) { return 1; }
+      vector<int> steps(nodes);
+      for (uint64_t r = rows; r-- > 0; ) {
+         uint32_t final = 0;
+         for (uint32_t i = 0; i < nodes; ++i) {
+            steps[i] = infectedStep(r, i);
+            if (steps[i] >= 0) { ++final; }
+         }
+         writer.write(r, r / 4 + 1, r % 4 + 1, r + 1, final, r * 10.0, steps, ts);
+      }
+      if (!writer.close()) { return 1; }
+   }
+
+   ColumnStore store;
+   bool ok = store.open(FILENAME) && store.nodes() == nodes && store.rows() == rows;
+   for (uint64_t r = 0; ok && r < rows; ++r) {
+      uint32_t final = 0;
+      for (uint32_t i = 0; ok && i < nodes; ++i) {
+         int step = infectedStep(r, i);
+         if (step >= 0) { ++final; }
+         ok = (store.infection(i)[r] == (step >= 0 ? step * ts : -1.0));
+      }
+      ok = ok && store.point()[r] == r / 4 + 1 && store.ant()[r] == r % 4 + 1 && store.run()[r] == r + 1 &&
+           store.finalSize()[r] == final && store.time()[r] == r * 10.0;
+      if (!ok) { cerr << "check_columns: row " << r << " differs." << endl; }
+   }
+
+   // A store whose size does not match its header is rejected
+   if (ok) {
+      FILE *f = fopen(FILENAME, "a");
+      fputc(0, f);
+      fclose(f);
+      ColumnStore grown;
+      if (grown.open(FILENAME)) {
+         cerr << "check_columns: opened a store of the wrong size." << endl;
+         ok = false;
+      }
+   }
+   remove(FILENAME);
+   if (!ok) {
+      cerr << "check_columns: the rows written could not be read back." << endl;
+      return 1;
+   }
+   cout << "ok" << endl;
+   return 0;
+}
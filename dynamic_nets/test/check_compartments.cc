@@ -0,0 +1,121 @@
+/*
+ * check_compartments.cc
+ *
+ * Checks the compartmental models of compartments.h: that an SI contact
+ * infects with probability SI_PROB and the same runs whether or not the
+ * delayed crossing rule is set explicitly, that SEIR nodes pass through
+ * each compartment after fixed delays and only pass on infection while
+ * infectious, and that another interaction rule (window overlap) decides
+ * the contacts when set. Built and run by compile.sh; prints "ok" or the
+ * first problem and fails.
+ */
+
+#include <cmath>
+#include <vector>
+#include <iostream>
+#include <compartments.h>
+
+using namespace std;
+
+/** Records the step each node first entered each compartment (-1 = never). */
+class SimObserverEntered : public SimObserver {
+public:
+   vector< vector<double> > entered;
+   SimObserverEntered (int nodes) : entered(nodes, vector<double>(COMP_COUNT, -1.0)) { }
+   void operator() (const State &x, double t) {
+      for (int i = 0; i < x.size(); ++i) {
+         double &e = entered[i][(int)x[i]];
+         if (e < 0.0) { e = t; }
+      }
+   }
+};
+
+/** Run a model once from node 0 infected, returning the observer. */
+SimObserverEntered run (const DynamicNet &net, const CompartmentModel &model, const Interaction *interaction,
+                        double probSI, System &sys) {
+   ChangeLog nullLogger;
+   SimulateCompartments sim(net);
+   sim.setModel(model);
+   sim.setParams(probSI, 0.0, 1.0);
+   sim.setInteraction(interaction);
+   State x(net.getSize(), 0.0);
+   x[0] = 1.0;
+   SimObserverEntered obs(net.getSize());
+   sim.simulate(sys, 50.0, x, obs, nullLogger);
+   return obs;
+}
+
+/** Whether a node entered a compartment at the given step. */
+bool enteredAt (const SimObserverEntered &obs, const string &name, int node, compartment_e c, double t) {
+   if (obs.entered[node][c] == t) { return true; }
+   cerr << "check_compartments: " << name << " node " << node << " entered compartment " << c << " at step "
+        << obs.entered[node][c] << ", expected " << t << "." << endl;
+   return false;
+}
+
+int main (int argc, char **argv) {
+   int k, runs = 20000;
+   DelayedCrossing delayed;
+   WindowOverlap overlap;
+   CompartmentModel model;
+
+   // SI over one contact at time 10: infected with probability SI_PROB, at that step
+   DynamicNet single(2);
+   single.addUpdate(0, 1, 10, 10);
+   single.index();
+   single.indexByTime();
+   model.byName("SI", 0.0, 0.0, false);
+   System sys1, sys2;
+   sys1.seedRnd(1);
+   sys2.seedRnd(1);
+   int count = 0;
+   for (k = 0; k < runs; ++k) {
+      SimObserverEntered obs1 = run(single, model, NULL, 0.3, sys1), obs2 = run(single, model, &delayed, 0.3, sys2);
+      if (obs1.entered != obs2.entered) {
+         cerr << "check_compartments: runs with the delayed rule set differ from the default." << endl;
+         return 1;
+      }
+      if (obs1.entered[1][COMP_I] >= 0.0) {
+         ++count;
+         if (!enteredAt(obs1, "SI", 1, COMP_I, 10.0)) { return 1; }
+      }
+   }
+   double fraction = (double)count / runs;
+   if (fabs(fraction - 0.3) > 4.0 * sqrt(0.3 * 0.7 / runs)) {
+      cerr << "check_compartments: SI infected " << fraction << " of runs, expected 0.3." << endl;
+      return 1;
+   }
+
+   // SEIR with fixed latency 2 and recovery 5: 0 is infectious over [0, 5), 1 is
+   // exposed at 3 and infectious over [5, 10), 2 is exposed at 6 and the contact
+   // from 0 to 3 at 10 comes after 0 recovered
+   DynamicNet chain(4);
+   chain.addUpdate(0, 1, 3, 3);
+   chain.addUpdate(1, 2, 6, 6);
+   chain.addUpdate(0, 3, 10, 10);
+   chain.index();
+   chain.indexByTime();
+   model.byName("SEIR", 2.0, 5.0, false);
+   SimObserverEntered seir = run(chain, model, NULL, 1.0, sys1);
+   if (!enteredAt(seir, "SEIR", 0, COMP_R, 5.0) || !enteredAt(seir, "SEIR", 1, COMP_E, 3.0) ||
+       !enteredAt(seir, "SEIR", 1, COMP_I, 5.0) || !enteredAt(seir, "SEIR", 1, COMP_R, 10.0) ||
+       !enteredAt(seir, "SEIR", 2, COMP_E, 6.0) || !enteredAt(seir, "SEIR", 2, COMP_I, 8.0) ||
+       !enteredAt(seir, "SEIR", 2, COMP_R, 13.0) || !enteredAt(seir, "SEIR", 3, COMP_E, -1.0)) { return 1; }
+
+   // SI with window overlap: 1 is infected when its interaction with 0 starts
+   // at 10, and 2 when its interaction with 1 (started at 8) ends at 30
+   DynamicNet direct(3);
+   direct.addUpdate(0, 1, 10, 12);
+   direct.addUpdate(1, 2, 8, 30);
+   direct.index();
+   direct.indexByTime();
+   overlap.prepare(direct);
+   model.byName("SI", 0.0, 0.0, false);
+   SimObserverEntered si = run(direct, model, &overlap, 1.0, sys1);
+   if (!enteredAt(si, "SI with overlap", 1, COMP_I, 10.0) || !enteredAt(si, "SI with overlap", 2, COMP_I, 30.0)) {
+      return 1;
+   }
+
+   cout << "ok" << endl;
+   return 0;
+}
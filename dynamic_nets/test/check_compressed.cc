@@ -0,0 +1,88 @@
+/*
+ * check_compressed.cc
+ *
+ * Checks that compressed crossings (see compressed.h) decode to the lists
+ * they were built from and that a compressed DynamicNet answers every
+ * lookup (crossing at a time, crossing in a window) exactly as the plain
+ * one, including the index identifying the crossing. The lists span
+ * several blocks and have repeated times and other times on either side.
+ * Built and run by compile.sh; prints "ok" or the first problem and fails.
+ */
+
+#include <vector>
+#include <iostream>
+#include <dynamic_nets.h>
+
+using namespace std;
+
+int main (int argc, char **argv) {
+   int n = 6, from, to, k, t, w;
+   tick_t tMax = 0;
+   DynamicNet plain(n), packed(n);
+   vector< vector< pair<tick_t,tick_t> > > lists(n * n);
+
+   // The same random crossings in both networks (up to a few blocks per edge)
+   uint64_t x = 12345;
+   for (from = 0; from < n; ++from) {
+      for (to = 0; to < n; ++to) {
+         tick_t l = 0;
+         int count = (int)((from * 131 + to * 17) % (3 * CROSSING_BLOCK));
+         for (k = 0; k < count; ++k) {
+            x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+            l += (tick_t)((x >> 33) % 4);
+            tick_t r = max((tick_t)0, l - (tick_t)((x >> 40) % 50) + 5);
+            plain.addUpdate(from, to, l, r);
+            packed.addUpdate(from, to, l, r);
+            lists[n * to + from].push_back(make_pair(l, r));
+            tMax = max(tMax, l);
+         }
+      }
+   }
+   plain.index();
+   plain.indexEnds();
+   packed.index();
+   packed.indexEnds();
+
+   // Decoding every list gives back what was stored
+   CompressedCrossings<tick_t> blocks(lists);
+   for (k = 0; k < n * n; ++k) {
+      tick_t l, r;
+      size_t i = 0;
+      CompressedCrossings<tick_t>::Cursor c = blocks.cursor(k);
+      while (c.next(l, r) && i < lists[k].size() && make_pair(l, r) == lists[k][i]) { ++i; }
+      if (blocks.size(k) != (int)lists[k].size() || i != lists[k].size() || c.next(l, r)) {
+         cerr << "check_compressed: list " << k << " does not decode to the crossings stored." << endl;
+         return 1;
+      }
+   }
+
+   // Every lookup matches the plain network
+   packed.compress();
+   for (from = 0; from < n; ++from) {
+      for (to = 0; to < n; ++to) {
+         if (plain.getCrossingCount(from, to) != packed.getCrossingCount(from, to)) {
+            cerr << "check_compressed: crossing counts of " << from << "," << to << " differ." << endl;
+            return 1;
+         }
+         for (t = 0; t <= tMax + 2; ++t) {
+            int c1 = -2, c2 = -2;
+            tick_t d1 = plain.getTimeSinceUpdate(from, to, t, c1), d2 = packed.getTimeSinceUpdate(from, to, t, c2);
+            if (d1 != d2 || (d1 != -1 && c1 != c2)) {
+               cerr << "check_compressed: crossing of " << from << "," << to << " at " << t << " differs." << endl;
+               return 1;
+            }
+            for (w = 1; w <= 8; w *= 2) {
+               c1 = c2 = -2;
+               bool in1 = plain.hasCrossingIn(from, to, t, t + w, c1), in2 = packed.hasCrossingIn(from, to, t, t + w, c2);
+               if (in1 != in2 || (in1 && c1 != c2)) {
+                  cerr << "check_compressed: crossing of " << from << "," << to << " in [" << t << ", " << t + w
+                       << ") differs." << endl;
+                  return 1;
+               }
+            }
+         }
+      }
+   }
+   cout << "ok" << endl;
+   return 0;
+}
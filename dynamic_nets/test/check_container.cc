@@ -0,0 +1,87 @@
+/*
+ * check_container.cc
+ *
+ * Checks that runs written to a container (see container.h) from several
+ * threads read back unchanged by (point, ant, run), that runs which were
+ * not written are not found and that an incomplete file is rejected.
+ * Built and run by compile.sh; prints "ok" or the first problem and fails.
+ */
+
+#include <cstdio>
+#include <map>
+#include <thread>
+#include <vector>
+#include <sstream>
+#include <iostream>
+#include <container.h>
+
+using namespace std;
+
+static const char *FILENAME = "check_container.dnc";
+
+/** Output of a run as the driver would format it (lengths vary, one is empty). */
+string runOutput (int point, int ant, int run) {
+   ostringstream out;
+   for (int i = 0; i < (point * 7 + ant * 3 + run) % 5; ++i) {
+      out << run << "," << i << "," << point << "," << ant << "\n";
+   }
+   return out.str();
+}
+
+int main (int argc, char **argv) {
+   int points = 2, ants = 3, runs = 20;
+
+   // Write the runs from several threads, each taking every fourth
+   {
+      ContainerWriter writer(FILENAME);
+      if (!writer.isOpen()) { return 1; }
+      vector<thread> threads;
+      for (int t = 0; t < 4; ++t) {
+         threads.push_back(thread([&, t] () {
+            for (int k = t; k < points * ants * runs; k += 4) {
+               int point = k / (ants * runs) + 1, ant = (k / runs) % ants + 1, run = k % runs + 1;
+               writer.append(point, ant, run, runOutput(point, ant, run));
+            }
+         }));
+      }
+      for (int t = 0; t < 4; ++t) { threads[t].join(); }
+      if (!writer.close()) { return 1; }
+   }
+
+   ContainerReader reader;
+   string data;
+   bool ok = reader.open(FILENAME) && reader.entries().size() == (size_t)(points * ants * runs);
+   for (int point = 1; ok && point <= points; ++point) {
+      for (int ant = 1; ok && ant <= ants; ++ant) {
+         for (int run = 1; ok && run <= runs; ++run) {
+            ok = reader.read(point, ant, run, data) && data == runOutput(point, ant, run);
+            if (!ok) { cerr << "check_container: run " << point << "," << ant << "," << run << " differs." << endl; }
+         }
+      }
+   }
+   if (ok && reader.read(1, 1, runs + 1, data)) {
+      cerr << "check_container: found a run that was not written." << endl;
+      ok = false;
+   }
+
+   // A container cut short (e.g. the program stopped early) has no index
+   if (ok) {
+      FILE *f = fopen(FILENAME, "r+");
+      fseek(f, 0, SEEK_END);
+      long size = ftell(f);
+      fclose(f);
+      ok = (truncate(FILENAME, size - 1) == 0);
+      ContainerReader cut;
+      if (ok && cut.open(FILENAME)) {
+         cerr << "check_container: opened an incomplete container." << endl;
+         ok = false;
+      }
+   }
+   remove(FILENAME);
+   if (!ok) {
+      cerr << "check_container: the runs written could not be read back." << endl;
+      return 1;
+   }
+   cout << "ok" << endl;
+   return 0;
+}
@@ -0,0 +1,105 @@
+/*
+ * check_gillespie.cc
+ *
+ * Checks the temporal Gillespie engine (see gillespie.h) against the
+ * probability of infection over a contact of length D at rate r with
+ * weight w, 1 - exp(-r w D): for a single contact, a decayed one, two in
+ * turn and a chain where a contact made before the infecting node was
+ * infected can not pass it on. Infections must also fall within their
+ * contacts. Built and run by compile.sh; prints "ok" or the first problem
+ * and fails.
+ */
+
+#include <cmath>
+#include <iostream>
+#include <gillespie.h>
+
+using namespace std;
+
+static const int RUNS = 20000;
+static const double RATE = 0.5, DURATION = 2.0;
+
+/** Records the time a node was first seen infected in a run (-1 = never). */
+class SimObserverInfected : public SimObserver {
+public:
+   int node;
+   double time;
+   SimObserverInfected (int node) : node(node), time(-1.0) { }
+   void operator() (const State &x, double t) {
+      if (time < 0.0 && x[node] == 1.0) { time = t; }
+   }
+};
+
+/**
+ * Fraction of runs, started with node 0 infected, that infect a node, and
+ * check that each infection lies in [earliest, latest].
+ */
+bool infected (const DynamicNet &net, double decayRate, int node, double earliest, double latest, double &fraction) {
+   System sys;
+   sys.seedRnd(1);
+   ChangeLog nullLogger;
+   SimulateTemporalGillespie gillespie(net);
+   gillespie.setParams(RATE, decayRate, 1.0, DURATION);
+   int count = 0;
+   for (int run = 0; run < RUNS; ++run) {
+      State x(net.getSize(), 0.0);
+      x[0] = 1.0;
+      SimObserverInfected obs(node);
+      gillespie.simulate(sys, 50.0, x, obs, nullLogger);
+      if (x[node] == 1.0) {
+         ++count;
+         if (obs.time < earliest || obs.time > latest) {
+            cerr << "check_gillespie: node " << node << " infected at " << obs.time << " outside its contacts." << endl;
+            return false;
+         }
+      }
+   }
+   fraction = (double)count / RUNS;
+   return true;
+}
+
+/** Whether a fraction is within four standard errors of a probability. */
+bool matches (const string &name, double fraction, double p) {
+   if (fabs(fraction - p) <= 4.0 * sqrt(p * (1.0 - p) / RUNS) + 1e-12) { return true; }
+   cerr << "check_gillespie: " << name << " infected " << fraction << " of runs, expected " << p << "." << endl;
+   return false;
+}
+
+int main (int argc, char **argv) {
+   double fraction, p = 1.0 - exp(-RATE * DURATION);
+
+   // One contact from node 0 to node 1 at time 10
+   DynamicNet single(2);
+   single.addUpdate(0, 1, 10, 10);
+   single.index();
+   single.indexByTime();
+   if (!infected(single, 0.0, 1, 10, 10 + DURATION, fraction) || !matches("one contact", fraction, p)) { return 1; }
+
+   // The same contact made 4 after node 0 was there, so weighted exp(-0.1 * 4)
+   DynamicNet decayed(2);
+   decayed.addUpdate(0, 1, 10, 6);
+   decayed.index();
+   decayed.indexByTime();
+   if (!infected(decayed, 0.1, 1, 10, 10 + DURATION, fraction) ||
+       !matches("a decayed contact", fraction, 1.0 - exp(-RATE * exp(-0.4) * DURATION))) { return 1; }
+
+   // Two contacts in turn
+   DynamicNet two(2);
+   two.addUpdate(0, 1, 10, 10);
+   two.addUpdate(0, 1, 20, 20);
+   two.index();
+   two.indexByTime();
+   if (!infected(two, 0.0, 1, 10, 20 + DURATION, fraction) || !matches("two contacts", fraction, 1.0 - (1.0 - p) * (1.0 - p))) { return 1; }
+
+   // A chain 0 -> 1 -> 2; the contact at 20 was made (at 5) before node 1 could be infected
+   DynamicNet chain(3);
+   chain.addUpdate(0, 1, 10, 10);
+   chain.addUpdate(1, 2, 20, 5);
+   chain.addUpdate(1, 2, 30, 25);
+   chain.index();
+   chain.indexByTime();
+   if (!infected(chain, 0.0, 2, 30, 30 + DURATION, fraction) || !matches("a chain", fraction, p * p)) { return 1; }
+
+   cout << "ok" << endl;
+   return 0;
+}
@@ -0,0 +1,90 @@
+/*
+ * check_mutate.cc
+ *
+ * Checks that the random mutations of NetEvo's MutateRandom are logged so
+ * the log can be replayed: every node is added (N+) before its arcs refer
+ * to it, no key is added twice, only existing arcs are removed, and the
+ * replayed nodes and arcs match the System at the end. Built and run by
+ * compile.sh; prints "ok" or the first inconsistency and fails.
+ */
+
+#include <cstdio>
+#include <set>
+#include <map>
+#include <sstream>
+#include <iostream>
+#include <netevo.h>
+
+using namespace std;
+using namespace netevo;
+
+int main (int argc, char **argv) {
+   System sys;
+   sys.seedRnd(1);
+   sys.ringGraph(20, 2, true);
+   sys.resetKeys();
+
+   // The replayed System starts as the ring
+   set<int> keys;
+   multiset< pair<int,int> > arcs;
+   for (System::NodeIt v(sys); v != INVALID; ++v) { keys.insert(sys.nodeData(v).key); }
+   for (System::ArcIt e(sys); e != INVALID; ++e) {
+      arcs.insert(make_pair(sys.nodeData(sys.source(e)).key, sys.nodeData(sys.target(e)).key));
+   }
+
+   MutateRandom mut;
+   mut.seedRnd(1);
+   mut.setNewEdgeProb(0.5);
+   mut.setDelEdgeProb(0.5);
+   mut.setRewireProb(0.5);
+   mut.setDuplicateProb(0.2);
+   ostringstream out;
+   ChangeLogToStream logger(out);
+   for (int step=0; step<500; ++step) {
+      mut.mutate(sys, logger);
+      logger.endStep(EVO_STEP);
+      logger.commit();
+   }
+
+   istringstream in(out.str());
+   string line;
+   int lineNo = 0, added = 0;
+   while (getline(in, line)) {
+      ++lineNo;
+      string op = line.substr(0, 2);
+      int a = 0, b = 0;
+      if (op == "N+" || op == "E+" || op == "E-") { sscanf(line.c_str() + 3, "%d,%d", &a, &b); }
+      bool ok = true;
+      if (op == "N+") {
+         ok = keys.insert(a).second;
+         ++added;
+      }
+      else if (op == "E+") {
+         ok = (keys.count(a) > 0 && keys.count(b) > 0);
+         arcs.insert(make_pair(a, b));
+      }
+      else if (op == "E-") {
+         multiset< pair<int,int> >::iterator itr = arcs.find(make_pair(a, b));
+         ok = (itr != arcs.end());
+         if (ok) { arcs.erase(itr); }
+      }
+      if (!ok) {
+         cerr << "check_mutate: line " << lineNo << " (" << line << ") is inconsistent." << endl;
+         return 1;
+      }
+   }
+
+   // The replay must end where the System did
+   set<int> sysKeys;
+   multiset< pair<int,int> > sysArcs;
+   for (System::NodeIt v(sys); v != INVALID; ++v) { sysKeys.insert(sys.nodeData(v).key); }
+   for (System::ArcIt e(sys); e != INVALID; ++e) {
+      sysArcs.insert(make_pair(sys.nodeData(sys.source(e)).key, sys.nodeData(sys.target(e)).key));
+   }
+   if (added == 0 || keys != sysKeys || arcs != sysArcs) {
+      cerr << "check_mutate: replaying the log does not give the mutated System." << endl;
+      return 1;
+   }
+   cout << "ok" << endl;
+   return 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * check_relabel.cc
+ *
+ * Checks DynamicNet::relabel() with the orderings of ordering.h: each
+ * ordering is a permutation, labels and nodes map back to each other
+ * (also after relabelling twice), and every lookup made through the
+ * original node numbers answers exactly as the network before it was
+ * relabelled. Built and run by compile.sh; prints "ok" or the first
+ * problem and fails.
+ */
+
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <ordering.h>
+
+using namespace std;
+
+/** Fill a network with the same pseudo-random crossings (some nodes have none). */
+void fill (DynamicNet &net, tick_t &tMax) {
+   uint64_t x = 987654321;
+   int n = net.getSize();
+   for (int from = 0; from < n; ++from) {
+      for (int to = 0; to < n; ++to) {
+         if (from == to || from % 7 == 3 || to % 7 == 3) { continue; }
+         int count = (int)((from * 13 + to * 5) % 6);
+         for (int k = 0; k < count; ++k) {
+            x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+            tick_t l = (tick_t)((x >> 33) % 100);
+            net.addUpdate(from, to, l, max((tick_t)0, l - (tick_t)((x >> 40) % 10)));
+            tMax = max(tMax, l);
+         }
+      }
+   }
+   net.index();
+}
+
+/** Whether the relabelled network answers every lookup as the plain one. */
+bool sameLookups (const DynamicNet &plain, const DynamicNet &relabelled, tick_t tMax, const string &name) {
+   int n = plain.getSize();
+   for (int k = 0; k < n; ++k) {
+      if (relabelled.getNode(relabelled.getLabel(k)) != k) {
+         cerr << "check_relabel: " << name << " node " << k << " does not map back from its label." << endl;
+         return false;
+      }
+   }
+   for (int from = 0; from < n; ++from) {
+      for (int to = 0; to < n; ++to) {
+         int rFrom = relabelled.getNode(from), rTo = relabelled.getNode(to);
+         if (plain.getCrossingCount(from, to) != relabelled.getCrossingCount(rFrom, rTo)) {
+            cerr << "check_relabel: " << name << " crossing counts of " << from << "," << to << " differ." << endl;
+            return false;
+         }
+         for (tick_t t = 0; t <= tMax + 1; ++t) {
+            int c1 = -2, c2 = -2;
+            tick_t d1 = plain.getTimeSinceUpdate(from, to, t, c1), d2 = relabelled.getTimeSinceUpdate(rFrom, rTo, t, c2);
+            if (d1 != d2 || (d1 != -1 && c1 != c2)) {
+               cerr << "check_relabel: " << name << " crossing of " << from << "," << to << " at " << t << " differs."
+                    << endl;
+               return false;
+            }
+         }
+      }
+   }
+   return true;
+}
+
+int main (int argc, char **argv) {
+   int n = 20;
+   tick_t tMax = 0;
+   DynamicNet plain(n);
+   fill(plain, tMax);
+
+   const char *names[] = { "degree", "rcm" };
+   DynamicNet twice(n);
+   fill(twice, tMax);
+   for (int k = 0; k < 2; ++k) {
+      DynamicNet net(n);
+      fill(net, tMax);
+      vector<int> order = nodeOrder(net, names[k]), sorted(order);
+      sort(sorted.begin(), sorted.end());
+      for (int i = 0; i < n; ++i) {
+         if (sorted.size() != n || sorted[i] != i) {
+            cerr << "check_relabel: the " << names[k] << " ordering is not a permutation of the nodes." << endl;
+            return 1;
+         }
+      }
+      net.relabel(order);
+      if (!sameLookups(plain, net, tMax, names[k])) { return 1; }
+      twice.relabel(nodeOrder(twice, names[k]));
+   }
+   if (!sameLookups(plain, twice, tMax, "degree then rcm")) { return 1; }
+
+   cout << "ok" << endl;
+   return 0;
+}
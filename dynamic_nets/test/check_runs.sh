@@ -0,0 +1,66 @@
+#!/bin/bash
+#
+# check_runs.sh
+#
+# Checks whole runs of the driver (../dynNet, built by compile.sh) on a
+# generated set of direct interactions:
+#   crn         runs with common random numbers are identical for the same
+#               seed whatever the number of threads, and differ for another
+#   early stop  runs stopped once nothing can change end in the same state
+#               as the full runs
+#   reorder     runs with common random numbers are identical whichever way
+#               the nodes are renumbered internally
+# Run by compile.sh; prints "ok" or the first problem and fails.
+
+cd "$(dirname "$0")"
+DATA=check_runs_data.txt
+OUT=check_runs_
+trap 'rm -f $DATA $OUT*' EXIT
+
+fail () {
+   echo "check_runs: $1" >&2
+   exit 1
+}
+
+# Same runs in two sets of files (PREFIX_ANT-*.txt)?
+same () {
+   for F in $1ANT-*.txt; do
+      cmp -s $F $2${F#$1} || return 1
+   done
+}
+
+# Final state of each run (run, then the states of its last row)
+finals () {
+   awk -F, '{ $2 = ""; last[$1] = $0 } END { for (r in last) { print last[r] } }' $1 | sort -n
+}
+
+# 30 nodes, with each pair interacting at a few pseudo-random times
+awk 'BEGIN {
+   x = 1
+   for (i = 1; i <= 30; ++i) for (j = i + 1; j <= 30; ++j) for (k = 0; k < 4; ++k) {
+      x = (x * 16807) % 2147483647
+      if (x % 5 == 0) { t = x % 300; print i "\t" j "\t" t "\t" t + x % 7 }
+   }
+}' > $DATA
+
+# DATA SIZE SI_PROB ANT RUNS LEN TIMESTEP OUT_FREQ PREFIX
+RUN="../dynNet --direct $DATA 30 0.05 -1 10 300 1 10"
+
+$RUN ${OUT}a_ --crn=7 --threads=1 > /dev/null || fail "the driver failed."
+$RUN ${OUT}b_ --crn=7 --threads=3 > /dev/null || fail "the driver failed."
+$RUN ${OUT}c_ --crn=8 --threads=1 > /dev/null || fail "the driver failed."
+same ${OUT}a_ ${OUT}b_ || fail "runs with the same --crn seed differ."
+same ${OUT}a_ ${OUT}c_ && fail "runs with different --crn seeds are identical."
+
+$RUN ${OUT}d_ --crn=7 --threads=1 --early-stop > /dev/null || fail "the driver failed."
+same ${OUT}a_ ${OUT}d_ && fail "stopping early did not shorten any run."
+for F in ${OUT}a_ANT-*.txt; do
+   [ "$(finals $F)" == "$(finals ${OUT}d_${F#${OUT}a_})" ] || fail "stopping early changed the final states in $F."
+done
+
+for ORDER in degree rcm; do
+   $RUN ${OUT}e_ --crn=7 --threads=1 --reorder=$ORDER > /dev/null || fail "the driver failed."
+   same ${OUT}a_ ${OUT}e_ || fail "runs with the nodes reordered by $ORDER differ."
+done
+
+echo "ok"
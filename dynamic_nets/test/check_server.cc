@@ -0,0 +1,181 @@
+/*
+ * check_server.cc
+ *
+ * Checks the server protocol of server.h over a real socket: a request
+ * written by a client is read back field for field, a bad magic number or
+ * a request cut short is refused, and error and result responses decode
+ * to the message and aggregates they were built from. Built and run by
+ * compile.sh; prints "ok" or the first problem and fails.
+ */
+
+#include <cstdio>
+#include <vector>
+#include <string>
+#include <iostream>
+#include <server.h>
+
+using namespace std;
+
+static const char *SOCKET_PATH = "check_server.sock";
+
+/** Client side of a connection: builds requests and decodes responses. */
+class Client {
+public:
+   int fd;
+   string out;
+   Client () : fd(-1) { }
+   ~Client () { if (fd >= 0) { ::close(fd); } }
+
+   bool connect () {
+      struct sockaddr_un addr;
+      memset(&addr, 0, sizeof(addr));
+      addr.sun_family = AF_UNIX;
+      strcpy(addr.sun_path, SOCKET_PATH);
+      fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+      return fd >= 0 && ::connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+   }
+
+   template <class T> void put (const T &value) { out.append((const char *)&value, sizeof(T)); }
+
+   bool send () {
+      bool ok = (::write(fd, out.data(), out.size()) == (ssize_t)out.size());
+      out.clear();
+      return ok;
+   }
+
+   template <class T> bool get (T &value) {
+      char *p = (char *)&value;
+      size_t len = sizeof(T);
+      while (len > 0) {
+         ssize_t n = ::read(fd, p, len);
+         if (n <= 0) { return false; }
+         p += n;
+         len -= n;
+      }
+      return true;
+   }
+};
+
+/** Fill a trace with a run where node i is infected at step 10 * i + shift. */
+void run (SimObserverRunTrace &trace, int nodes, int len, int shift) {
+   State state(nodes, 0.0);
+   trace.reset();
+   for (int t = 0; t <= len; ++t) {
+      for (int i = 0; i < nodes; ++i) {
+         if (10 * i + shift <= t) { state[i] = 1.0; }
+      }
+      trace(state, (double)t);
+   }
+}
+
+int main (int argc, char **argv) {
+   Server server(SOCKET_PATH);
+   Client client;
+   if (!server.listen() || !client.connect()) {
+      cerr << "check_server: could not connect to the server's socket." << endl;
+      return 1;
+   }
+   int fd = server.accept();
+   if (fd < 0) {
+      cerr << "check_server: could not accept the connection." << endl;
+      return 1;
+   }
+   ServerConnection conn(fd);
+
+   // A request, then one with a bad magic number
+   client.put(SERVER_REQUEST_MAGIC);
+   uint32_t fields[] = { 2, 3, 40, 100, 10, SERVER_FLAG_CRN };
+   for (int k = 0; k < 6; ++k) { client.put(fields[k]); }
+   client.put(0.25);
+   client.put(0.5);
+   client.put(2.0);
+   client.put(1.5);
+   client.put((uint64_t)123456789012345ULL);
+   client.put((uint32_t)0x12345678);
+   client.send();
+   ServerRequest req;
+   if (!conn.readRequest(req) || req.dataset != 2 || req.ant != 3 || req.runs != 40 || req.len != 100 ||
+       req.outFreq != 10 || req.flags != SERVER_FLAG_CRN || req.probSI != 0.25 || req.decayRate != 0.5 ||
+       req.ts != 2.0 || req.contactDuration != 1.5 || req.seed != 123456789012345ULL) {
+      cerr << "check_server: the request read differs from the one sent." << endl;
+      return 1;
+   }
+   if (conn.readRequest(req)) {
+      cerr << "check_server: accepted a request with a bad magic number." << endl;
+      return 1;
+   }
+
+   // An error response
+   string message = "no such data set";
+   uint32_t magic, status, length;
+   conn.sendError(message);
+   string received;
+   if (!client.get(magic) || !client.get(status) || !client.get(length) || magic != SERVER_RESPONSE_MAGIC ||
+       status != 1 || length != message.size()) {
+      cerr << "check_server: the error response has a bad header." << endl;
+      return 1;
+   }
+   received.resize(length);
+   for (int k = 0; k < length; ++k) { client.get(received[k]); }
+   if (received != message) {
+      cerr << "check_server: the error message received differs from the one sent." << endl;
+      return 1;
+   }
+
+   // A result response for two ants
+   int nodes = 4, len = 40;
+   double ts = 0.5;
+   vector<int> rowSteps = outputSteps(len, 10), ants;
+   vector<double> fractions(1, 0.5);
+   vector<RunAggregate *> aggregates;
+   SimObserverRunTrace trace(rowSteps, nodes);
+   for (int a = 0; a < 2; ++a) {
+      ants.push_back(a * 3);
+      aggregates.push_back(new RunAggregate(nodes, rowSteps, fractions));
+      for (int r = 0; r < 5; ++r) {
+         run(trace, nodes, len, r * (a + 1));
+         aggregates[a]->add(trace);
+      }
+   }
+   conn.sendResults(ants, aggregates, nodes, ts);
+   uint32_t rNodes, rows, rAnts;
+   bool ok = client.get(magic) && client.get(status) && client.get(rNodes) && client.get(rows) &&
+             client.get(rAnts) && magic == SERVER_RESPONSE_MAGIC && status == 0 && rNodes == nodes &&
+             rows == rowSteps.size() && rAnts == ants.size();
+   double d;
+   int32_t q;
+   for (int i = 0; ok && i < rows; ++i) { ok = client.get(d) && d == rowSteps[i] * ts; }
+   for (int a = 0; ok && a < rAnts; ++a) {
+      RunAggregate &agg = *aggregates[a];
+      uint32_t ant, runs;
+      ok = client.get(ant) && client.get(runs) && ant == ants[a] + 1 && runs == agg.runs();
+      ok = ok && client.get(d) && d == agg.finalSize().mean && client.get(d) && d == agg.finalSize().variance();
+      for (int k = 0; ok && k < SUMMARY_NUM_QUANTILES; ++k) {
+         ok = client.get(q) && q == agg.finalSizeSketch().quantile(SUMMARY_QUANTILES[k]);
+      }
+      for (int i = 0; ok && i < rows; ++i) { ok = client.get(d) && d == agg.curve()[i].mean; }
+      for (int i = 0; ok && i < rows; ++i) { ok = client.get(d) && d == agg.curve()[i].variance(); }
+      for (int i = 0; ok && i < nodes; ++i) {
+         ok = client.get(d) && d == (double)agg.nodeInfected()[i] / agg.runs();
+      }
+   }
+   for (int a = 0; a < aggregates.size(); ++a) { delete aggregates[a]; }
+   if (!ok) {
+      cerr << "check_server: the results received differ from the aggregates sent." << endl;
+      return 1;
+   }
+
+   // A request cut short by the client closing the connection
+   client.put(SERVER_REQUEST_MAGIC);
+   client.put((uint32_t)1);
+   client.send();
+   ::close(client.fd);
+   client.fd = -1;
+   if (conn.readRequest(req)) {
+      cerr << "check_server: accepted a request cut short." << endl;
+      return 1;
+   }
+
+   cout << "ok" << endl;
+   return 0;
+}
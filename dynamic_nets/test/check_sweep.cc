@@ -0,0 +1,83 @@
+/*
+ * check_sweep.cc
+ *
+ * Checks the parameter sweeps of sweep.h: value lists and ranges (ends
+ * included despite rounding, mixed with single values), malformed ranges
+ * giving no values, the order of the grid, and that runs submitted out of
+ * order to an OrderedOutput are written in order. Built and run by
+ * compile.sh; prints "ok" or the first problem and fails.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <sweep.h>
+
+using namespace std;
+
+static const char *FILENAME = "check_sweep.txt";
+
+/** Whether a specification parses to the expected values (up to rounding). */
+bool parses (const string &spec, const vector<double> &expected) {
+   vector<double> values = parseValues(spec);
+   bool same = (values.size() == expected.size());
+   for (int i = 0; same && i < values.size(); ++i) {
+      same = fabs(values[i] - expected[i]) <= 1e-12;
+   }
+   if (!same) {
+      cerr << "check_sweep: \"" << spec << "\" gives " << values.size() << " values, expected " << expected.size()
+           << "." << endl;
+   }
+   return same;
+}
+
+int main (int argc, char **argv) {
+   double range[] = { 0.1, 0.2, 0.3, 0.4, 0.5 }, mixed[] = { 0.05, 1.0, 1.5, 2.0, 0.7 }, single[] = { 0.3 };
+   vector<double> none;
+   if (!parses("0.1:0.1:0.5", vector<double>(range, range + 5)) ||
+       !parses("0.05,1:0.5:2,0.7", vector<double>(mixed, mixed + 5)) ||
+       !parses("0.3", vector<double>(single, single + 1)) ||
+       !parses("0.1:0.2", none) || !parses("0.1:0.1:0.5:1", none) || !parses("0.1:0:0.5", none) ||
+       !parses("0.5:-0.1:0.1", none) || !parses("0.1,0.1:0:0.5", none)) { return 1; }
+
+   // SI_PROB varies fastest, then DECAY_RATE, then TIMESTEP
+   vector<double> probs(range, range + 2), decays(mixed, mixed + 3), tss(single, single + 1);
+   tss.push_back(2.0);
+   vector<SweepPoint> grid = buildGrid(probs, decays, tss);
+   bool ordered = (grid.size() == 12);
+   for (int k = 0; ordered && k < 12; ++k) {
+      ordered = grid[k].probSI == probs[k % 2] && grid[k].decayRate == decays[(k / 2) % 3] && grid[k].ts == tss[k / 6];
+   }
+   if (!ordered) {
+      cerr << "check_sweep: the grid is not in order." << endl;
+      return 1;
+   }
+
+   // Runs finishing out of order are written in order
+   int runs = 6, order[] = { 3, 1, 0, 5, 2, 4 };
+   {
+      OrderedOutput out(FILENAME, runs);
+      for (int k = 0; k < runs; ++k) {
+         ostringstream data;
+         data << "run " << order[k] << endl;
+         string s = data.str();
+         out.submit(order[k], s);
+      }
+   }
+   ifstream in(FILENAME);
+   ostringstream written, expected;
+   written << in.rdbuf();
+   for (int k = 0; k < runs; ++k) { expected << "run " << k << endl; }
+   remove(FILENAME);
+   if (written.str() != expected.str()) {
+      cerr << "check_sweep: runs submitted out of order were not written in order." << endl;
+      return 1;
+   }
+
+   cout << "ok" << endl;
+   return 0;
+}
@@ -39,5 +39,71 @@ namespace netevo {
          if (mRnd() < mProbDup)     { duplicate(sys, logger); }
       }
    }
+   
+   void MutateRandom::newEdge (System &sys, ChangeLog &logger) {
+      if (sys.nodeCount() < 2) { return; }
+      Node u = sys.randomNode(mRnd);
+      Node v = sys.randomNode(mRnd);
+      if (u == v || findArc(sys, u, v) != INVALID) { return; }
+      logger.addArc(sys, u, v);
+      sys.addArc(u, v, mNewEdgeDyn);
+   }
+   
+   void MutateRandom::delEdge (System &sys, ChangeLog &logger) {
+      Arc e = sys.randomArc(mRnd);
+      if (e == INVALID) { return; }
+      logger.erase(sys, e);
+      sys.erase(e);
+   }
+   
+   void MutateRandom::rewire (System &sys, ChangeLog &logger) {
+      Arc e = sys.randomArc(mRnd);
+      if (e == INVALID) { return; }
+      Node u = sys.source(e);
+      Node w = sys.randomNode(mRnd);
+      if (w == u || w == sys.target(e) || findArc(sys, u, w) != INVALID) { return; }
+      // Logged as the arc being replaced by one to its new target
+      logger.erase(sys, e);
+      logger.addArc(sys, u, w);
+      sys.changeTarget(e, w);
+      sys.invalidateStateIDs();
+   }
+   
+   void MutateRandom::duplicate (System &sys, ChangeLog &logger) {
+      Node v = sys.randomNode(mRnd);
+      if (v == INVALID) { return; }
+      
+      // Copy the node (its data is only found once the copy is added, which can move it).
+      // The copy is logged once added, as a node has no key to log until then.
+      Node w = sys.addNode(sys.nodeData(v).name, sys.nodeData(v).dynamic->getName());
+      logger.addNode(sys, w);
+      const NodeData &vData = sys.nodeData(v);
+      NodeData &wData = sys.editNodeData(w);
+      wData.position = vData.position;
+      wData.properties = vData.properties;
+      wData.dynamicParams = vData.dynamicParams;
+      
+      // Copy its arcs (a self-loop on the node becomes one on the copy). Those to be copied
+      // are found first as adding arcs can move the data they are copied from.
+      vector<Arc> outArcs, inArcs;
+      for (System::OutArcIt e(sys, v); e != INVALID; ++e) { outArcs.push_back(e); }
+      for (System::InArcIt e(sys, v); e != INVALID; ++e) {
+         if (sys.source(e) != v) { inArcs.push_back(e); }
+      }
+      for (int i=0; i<(int)(outArcs.size() + inArcs.size()); ++i) {
+         bool out = (i < (int)outArcs.size());
+         Arc e = out ? outArcs[i] : inArcs[i - outArcs.size()];
+         Node s = out ? w : sys.source(e);
+         Node t = out ? ((sys.target(e) == v) ? w : sys.target(e)) : w;
+         logger.addArc(sys, s, t);
+         Arc eNew = sys.addArc(s, t, sys.arcData(e).dynamic->getName());
+         const ArcData &eData = sys.arcData(e);
+         ArcData &eNewData = sys.editArcData(eNew);
+         eNewData.name = eData.name;
+         eNewData.weight = eData.weight;
+         eNewData.properties = eData.properties;
+         eNewData.dynamicParams = eData.dynamicParams;
+      }
+   }
 
 } // netevo namespace
@@ -54,6 +54,9 @@ namespace netevo {
       
       int mMutateTrials;
       
+      /** Dynamic given to arcs added by newEdge */
+      string mNewEdgeDyn;
+      
       Random mRnd;
       
    public:
@@ -67,6 +70,7 @@ namespace netevo {
          mProbRewire   = 0.0;
          mProbDup      = 0.0;
          mMutateTrials = 1;
+         mNewEdgeDyn   = "NoArcDynamic";
          mRnd.seed();
       }
       
@@ -83,17 +87,27 @@ namespace netevo {
       void setDuplicateProb (double prob) { mProbDup     = prob; }
       
       void setMutateTrials  (int num) { mMutateTrials = num; }
+      
+      void setNewEdgeDynamic (string dynamic) { mNewEdgeDyn = dynamic; }
 
       virtual void mutate (System &sys, ChangeLog &logger);
       
       virtual void newNode   (System &sys, ChangeLog &logger) { }
       virtual void delNode   (System &sys, ChangeLog &logger) { }
-      virtual void newEdge   (System &sys, ChangeLog &logger) { }
-      virtual void delEdge   (System &sys, ChangeLog &logger) { }
       virtual void updNode   (System &sys, ChangeLog &logger) { }
       virtual void updEdge   (System &sys, ChangeLog &logger) { }
-      virtual void rewire    (System &sys, ChangeLog &logger) { }
-      virtual void duplicate (System &sys, ChangeLog &logger) { }
+      
+      /** Add an arc (with the new edge dynamic) between two distinct random nodes, unless 
+       *  they are already joined in that direction. */
+      virtual void newEdge   (System &sys, ChangeLog &logger);
+      /** Remove a random arc. */
+      virtual void delEdge   (System &sys, ChangeLog &logger);
+      /** Move the target of a random arc to another random node, unless that would make a 
+       *  self-loop or an arc that already exists. The arc keeps its data. */
+      virtual void rewire    (System &sys, ChangeLog &logger);
+      /** Add a copy of a random node, with the same data and copies of all its arcs. The copy 
+       *  is logged once added and each of its arcs before being added. */
+      virtual void duplicate (System &sys, ChangeLog &logger);
    };
 
    class Performance {
@@ -31,7 +31,7 @@ namespace netevo {
       
       // We are in discrete time so use integers for time
       int t = 0, tEnd = (int)tMax;
-      int states = (countNodes(sys)*sys.nodeStates()) + (countArcs(sys)*sys.arcStates());
+      int states = sys.totalStates();
 
       // Check to ensure that initial conditions are correct size
       if (initial.size() < states || initial.size() > states) {
@@ -39,9 +39,11 @@ namespace netevo {
          return;
       }
 
-      // Vector to hold the output. Copy the initial conditions and add to the output
-      State y1 = State(initial);
-      State y2 = State(initial);
+      // Simulate in place, alternating between the initial conditions and a
+      // second buffer that is only reallocated if the size changes
+      State &y1 = initial;
+      State &y2 = mNext;
+      y2.assign(initial.begin(), initial.end());
 
       // Check that the state IDs are correct, if not refresh
       if (!sys.validStateIDs()) { sys.refreshStateIDs(); }
@@ -52,8 +54,12 @@ namespace netevo {
       logger.commit();
       obs(y1, 0.0);
       
+      // Keep track of the latest state so we can stop at any point
+      State *last = &y1;
+      bool stopped = (mStop != NULL && mStop->stop(sys, y1, 0.0));
+      
       // Loop through all time steps and calculate new states
-      for (t = 1; t <= tEnd; t++) {
+      for (t = 1; t <= tEnd && !stopped; t++) {
          if (t%2 == 0) {
             // Use y1 as old and y2 as new
             // Simulate the dynamics
@@ -64,6 +70,7 @@ namespace netevo {
             logger.commit();
             // Send result to the observer
             obs(y2, (double)t);
+            last = &y2;
          }
          else {
             // Use y2 as old and y1 as new
@@ -75,17 +82,22 @@ namespace netevo {
             logger.commit();
             // Send result to the observer
             obs(y1, (double)t);
+            last = &y1;
+         }
+         // Check whether anything can still change
+         if (mStop != NULL && mStop->stop(sys, *last, (double)t)) {
+            stopped = true;
          }
       }
       
       // Ensure the initial vector is updated to the final result
-      initial = ( t%2 == 0 )  ? y1 : y2;
+      if (last != &y1) { y1.swap(y2); }
    }
 
    void SimulateOdeFixed::simulate (System &sys, double tMax, State &initial, SimObserver &obs, ChangeLog &logger) {
       
       // Check to ensure that initial conditions are correct size
-      int states = (countNodes(sys)*sys.nodeStates()) + (countArcs(sys)*sys.arcStates());
+      int states = sys.totalStates();
       if (initial.size() < states || initial.size() > states) {
          cerr << "Incorrect number of states for initial conditions (SimulateOdeFixed::simulate)" << endl;
          return;
@@ -118,7 +130,7 @@ namespace netevo {
    void SimulateOdeConst::simulate (System &sys, double tMax, State &initial, SimObserver &obs, ChangeLog &logger) {
       
       // Check to ensure that initial conditions are correct size
-      int states = (countNodes(sys)*sys.nodeStates()) + (countArcs(sys)*sys.arcStates());
+      int states = sys.totalStates();
       if (initial.size() < states || initial.size() > states) {
          cerr << "Incorrect number of states for initial conditions (SimulateOdeConst::simulate)" << endl;
          return;
@@ -154,7 +166,7 @@ namespace netevo {
    void SimulateOdeAdaptive::simulate (System &sys, double tMax, State &initial, SimObserver &obs, ChangeLog &logger) {
       
       // Check to ensure that initial conditions are correct size
-      int states = (countNodes(sys)*sys.nodeStates()) + (countArcs(sys)*sys.arcStates());
+      int states = sys.totalStates();
       if (initial.size() < states || initial.size() > states) {
          cerr << "Incorrect number of states for initial conditions (SimulateOdeAdaptive::simulate)" << endl;
          return;
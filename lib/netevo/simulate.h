@@ -43,6 +43,7 @@ namespace netevo {
    
    class SimObserver {
    public:
+      virtual ~SimObserver () { }
       /** This should be overwritten by any observer. By default does nothing. */
       virtual void operator() (const State &x, double t) { };
    };
@@ -79,6 +80,14 @@ namespace netevo {
       }
    };
 
+   /** Allows a simulation to be halted early once its state can no longer change. */
+   class SimStopCondition {
+   public:
+      virtual ~SimStopCondition () { }
+      /** Should return true if the state x reached at time t is absorbing. By default never stops. */
+      virtual bool stop (System &sys, const State &x, double t) { return false; };
+   };
+
    /** Virtual class to define the interface for simulation of a System. */
    class Simulate {
       public:
@@ -87,8 +96,15 @@ namespace netevo {
 
    class SimulateMap : public Simulate {
    public:
-      SimulateMap () { };
+      SimulateMap () { mStop = NULL; };
       void simulate (System &sys, double tMax, State &initial, SimObserver &obs, ChangeLog &logger);
+      /** Stop before tMax if the condition is met (NULL to always run to tMax). The final state 
+       *  is observed once, at the time the condition was met. */
+      void setStopCondition (SimStopCondition *stop) { mStop = stop; }
+   private:
+      SimStopCondition *mStop;
+      /** Second state buffer, kept between calls so repeated runs do not allocate. */
+      State mNext;
    };
 
    class SimulateOdeFixed : public Simulate {
@@ -28,16 +28,18 @@
 namespace netevo {
 
    void System::operator() (const State &x, State &dx, const double t) {
+      int i;
+      if (!validStateIDs()) { refreshStateIDs(); }
       // Each vertex updates itself
       if (mNodeStates > 0) {
-         for (System::NodeIt v(*this); v != INVALID; ++v) {
-            (*mNodeData)[v].dynamic->fn(v, *this, x, dx, t);
+         for (i=0; i<mNodeList.size(); ++i) {
+            mNodeDynamicList[i]->fn(mNodeList[i], *this, x, dx, t);
          }
       }
       // Each edge updates itself
       if (mArcStates > 0) {
-         for (System::ArcIt e(*this); e != INVALID; ++e) {
-            (*mArcData)[e].dynamic->fn(e, *this, x, dx, t);
+         for (i=0; i<mArcList.size(); ++i) {
+            mArcDynamicList[i]->fn(mArcList[i], *this, x, dx, t);
          }
       }        
    }
@@ -63,7 +65,9 @@ namespace netevo {
       (*mNodeData)[v].dynamic = dyn;
       (*mNodeData)[v].dynamicParams.clear();
       dyn->setDefaultParams(v, *this);
+      // Arc states follow the node states so they move too
       mValidNodeIDs = false;
+      mValidArcIDs = false;
       return v;
    }
 
@@ -102,6 +106,136 @@ namespace netevo {
       return pair<Arc,Arc>(a1,a2);
    }
    
+   NodeDynamic * System::getNodeDynamic (string name) {
+      std::map<string, NodeDynamic*>::iterator itr = mNodeDynamics.find(name);
+      return (itr == mNodeDynamics.end()) ? NULL : itr->second;
+   }
+   
+   ArcDynamic * System::getArcDynamic (string name) {
+      std::map<string, ArcDynamic*>::iterator itr = mArcDynamics.find(name);
+      return (itr == mArcDynamics.end()) ? NULL : itr->second;
+   }
+   
+   bool System::build (const vector<NodeDynamic*> &nodeDynamics, const vector< pair<int,int> > &arcList,
+                       const vector<ArcDynamic*> &arcDynamics) {
+      if (arcDynamics.size() != arcList.size()) {
+         cerr << "Number of arc dynamics does not match the number of arcs (System::build)" << endl;
+         return false;
+      }
+      return build(nodeDynamics.size(), nodeDynamics.data(), 1, arcList, arcDynamics.data(), 1);
+   }
+   
+   bool System::build (int numOfNodes, NodeDynamic *nodeDynamic, const vector< pair<int,int> > &arcList,
+                       ArcDynamic *arcDynamic) {
+      return build(numOfNodes, &nodeDynamic, 0, arcList, &arcDynamic, 0);
+   }
+   
+   bool System::build (int numOfNodes, NodeDynamic * const *nodeDynamics, int nodeStride,
+                       const vector< pair<int,int> > &arcList, ArcDynamic * const *arcDynamics, int arcStride) {
+      int i, k, numOfArcs = arcList.size();
+      
+      // Check the input before anything is changed, as the lists are linked unchecked
+      for (i=0; i<numOfNodes; ++i) {
+         if (nodeDynamics[i * nodeStride] == NULL) {
+            cerr << "Missing dynamic for node " << i << " (System::build)" << endl;
+            return false;
+         }
+      }
+      for (k=0; k<numOfArcs; ++k) {
+         int u = arcList[k].first, v = arcList[k].second;
+         if (u < 0 || u >= numOfNodes || v < 0 || v >= numOfNodes) {
+            cerr << "Arc " << k << " (" << u << ", " << v << ") joins a node that does not exist (System::build)" << endl;
+            return false;
+         }
+         if (arcDynamics[k * arcStride] == NULL) {
+            cerr << "Missing dynamic for arc " << k << " (System::build)" << endl;
+            return false;
+         }
+      }
+      
+      // Clear any existing structure
+      clear();
+      
+      // Lay out the digraph's lists exactly as adding each node and then each arc in
+      // turn would, but without notifying the maps of every element. Nodes are linked
+      // newest first and each node's arcs likewise, so an arc's next arc is the one
+      // added before it and its previous arc the one added after it.
+      nodes.resize(numOfNodes);
+      for (i=0; i<numOfNodes; ++i) {
+         nodes[i].next = i - 1;
+         nodes[i].prev = (i + 1 < numOfNodes) ? i + 1 : -1;
+         nodes[i].first_in = nodes[i].first_out = -1;
+      }
+      first_node = numOfNodes - 1;
+      arcs.resize(numOfArcs);
+      for (k=0; k<numOfArcs; ++k) {
+         int u = arcList[k].first, v = arcList[k].second;
+         arcs[k].source = u;
+         arcs[k].target = v;
+         arcs[k].next_out = nodes[u].first_out;
+         arcs[k].next_in = nodes[v].first_in;
+         nodes[u].first_out = k;
+         nodes[v].first_in = k;
+      }
+      vector<int> laterOut(numOfNodes, -1), laterIn(numOfNodes, -1);
+      for (k=numOfArcs-1; k>=0; --k) {
+         arcs[k].prev_out = laterOut[arcs[k].source];
+         arcs[k].prev_in = laterIn[arcs[k].target];
+         laterOut[arcs[k].source] = k;
+         laterIn[arcs[k].target] = k;
+      }
+      
+      // Size every map (ours and any others of the System) once
+      notifier(Node()).build();
+      notifier(Arc()).build();
+      
+      // Initialise the data as addNode and addArc would
+      for (i=0; i<numOfNodes; ++i) {
+         Node v = nodeFromId(i);
+         NodeData &data = (*mNodeData)[v];
+         data.key = mNextKey;
+         mNextKey++;
+         data.position.x = 0.0;
+         data.position.y = 0.0;
+         data.position.z = 0.0;
+         data.dynamic = nodeDynamics[i * nodeStride];
+         data.dynamic->setDefaultParams(v, *this);
+      }
+      for (k=0; k<numOfArcs; ++k) {
+         Arc e = arcFromId(k);
+         ArcData &data = (*mArcData)[e];
+         data.weight = 1.0;
+         data.dynamic = arcDynamics[k * arcStride];
+         data.dynamic->setDefaultParams(e, *this);
+      }
+      
+      mValidNodeIDs = false;
+      mValidArcIDs = false;
+      return true;
+   }
+   
+   void System::erase (Node v) {
+      // Remove the node's arcs first so their IDs are invalidated too
+      for (OutArcIt e(*this, v); e != INVALID; ) {
+         Arc old = e;
+         ++e;
+         erase(old);
+      }
+      for (InArcIt e(*this, v); e != INVALID; ) {
+         Arc old = e;
+         ++e;
+         erase(old);
+      }
+      Parent::erase(v);
+      mValidNodeIDs = false;
+      mValidArcIDs = false;
+   }
+   
+   void System::erase (Arc e) {
+      Parent::erase(e);
+      mValidArcIDs = false;
+   }
+   
    Node System::getNode (int ID) {
       // Iterate through (change to map in future)
       System::NodeIt v(*this);
@@ -572,26 +706,22 @@ namespace netevo {
    void System::ringGraph (int numOfNodes, int neighbours, string defNodeDyn, string defEdgeDyn, bool undirected) {
       int i, j;
       
-      // Clear any existing structure
-      clear();
-      
-      // Create the required number of nodes 
-      for (int i=0; i<numOfNodes; ++i) {
-         addNode(defNodeDyn);
-      }
-      
-      i = 0;
-      for (System::NodeIt v(*this); v != INVALID; ++v) {
+      // Nodes are linked to the next neighbours in iteration order, which is the reverse
+      // of the order they are created in (node i in iteration order has id n-1-i)
+      vector< pair<int,int> > arcList;
+      arcList.reserve(numOfNodes * neighbours * (undirected ? 2 : 1));
+      for (i=0; i<numOfNodes; ++i) {
+         int u = numOfNodes - 1 - i;
          for (j=i+1; j<=i+neighbours; ++j) {
+            int v = numOfNodes - 1 - (j%numOfNodes);
             if (undirected) {
-               addEdge(v, getNode(j%numOfNodes), defEdgeDyn);
-            }
-            else {
-               addArc(v, getNode(j%numOfNodes), defEdgeDyn);
+               // As addEdge
+               arcList.push_back(pair<int,int>(v, u));
             }
+            arcList.push_back(pair<int,int>(u, v));
          }
-         ++i;
       }
+      build(numOfNodes, getNodeDynamic(defNodeDyn), arcList, getArcDynamic(defEdgeDyn));
       
       // Update the state ID mapping
       refreshStateIDs();
@@ -698,32 +828,54 @@ namespace netevo {
    void System::refreshStateIDs () {
       int i = 0;
       
-      // Update node IDs
+      // Update node IDs: each node's states start after those of the nodes
+      // before it, and it has as many as its own dynamic needs
       if (!mValidNodeIDs) {
          i = 0;
+         mNodeList.clear();
+         mNodeDynamicList.clear();
+         mNodeParamStart.clear();
+         mNodeParamList.clear();
          for (NodeIt v(*this); v != INVALID; ++v) {
+            NodeData &data = (*mNodeData)[v];
             (*mNodeIDs)[v] = i;
-            ++i;
+            i += data.dynamic->getStates();
+            // Gather the data used while simulating
+            (*mNodeIndex)[v] = mNodeList.size();
+            mNodeList.push_back(v);
+            mNodeDynamicList.push_back(data.dynamic);
+            mNodeParamStart.push_back(mNodeParamList.size());
+            mNodeParamList.insert(mNodeParamList.end(), data.dynamicParams.begin(), data.dynamicParams.end());
          }
+         mNodeStateCount = i;
+         mValidNodeIDs = true;
+         // Arc states follow those of every node
+         mValidArcIDs = false;
       }
       
-      // Update arc IDs
+      // Update arc IDs in the same way
       if (!mValidArcIDs) {
-         i = 0;
+         i = mNodeStateCount;
+         mArcList.clear();
+         mArcDynamicList.clear();
+         mArcParamStart.clear();
+         mArcParamList.clear();
+         mArcWeightList.clear();
          for (ArcIt e(*this); e != INVALID; ++e) {
+            ArcData &data = (*mArcData)[e];
             (*mArcIDs)[e] = i;
-            ++i;
+            i += data.dynamic->getStates();
+            (*mArcIndex)[e] = mArcList.size();
+            mArcList.push_back(e);
+            mArcDynamicList.push_back(data.dynamic);
+            mArcParamStart.push_back(mArcParamList.size());
+            mArcParamList.insert(mArcParamList.end(), data.dynamicParams.begin(), data.dynamicParams.end());
+            mArcWeightList.push_back(data.weight);
          }
+         mArcStateCount = i - mNodeStateCount;
+         mValidArcIDs = true;
       }
    }
-
-   int System::stateID (Node v) {
-      return (mNodeStates * (*mNodeIDs)[v]);
-   }
-
-	int System::stateID (Arc e) {
-		return ((mNodeStates * countNodes(*this)) + (mArcStates * (*mArcIDs)[e]));
-	}
    
    void ChangeLogSet::addChangeLog (ChangeLog *logger) {
       mLoggers.push_back(logger);
@@ -825,7 +977,7 @@ namespace netevo {
          for (System::NodeIt n(sys); n != INVALID; ++n) {
             buffer << "NS," << sys.nodeData(n).key;
             stateIndex = sys.stateID(n);
-            for (i=0; i<sys.nodeStates(); ++i) {
+            for (i=0; i<sys.nodeData(n).dynamic->getStates(); ++i) {
                buffer << "," << newState[stateIndex + i];
             }
             buffer << endl;
@@ -837,7 +989,7 @@ namespace netevo {
             Node target = sys.target(e);
             buffer << "ES," << sys.nodeData(source).key << "," << sys.nodeData(target).key;
             stateIndex = sys.stateID(e);
-            for (i=0; i<sys.arcStates(); ++i) {
+            for (i=0; i<sys.arcData(e).dynamic->getStates(); ++i) {
                buffer << "," << newState[stateIndex + i];
             }
             buffer << endl;
@@ -28,6 +28,7 @@
 #include <iostream>
 #include <fstream>
 #include <lemon/list_graph.h>
+#include <lemon/bits/vector_map.h>
 #include <lemon/random.h>
 #include <lemon/connectivity.h>
 #include <Eigen/Eigenvalues>
@@ -109,31 +110,143 @@ namespace netevo {
       vector<double>  dynamicParams;
    };
 
+   /** Dense set of the live nodes (or arcs) of a digraph
+    *  Attached to the digraph's notifier so it follows every addition and removal, however it
+    *  is made. The items are held contiguously, so the i-th item and a uniformly random one are
+    *  found in constant time. A removed item is replaced by the last one, so the order is not
+    *  that of iterating over the digraph. When the digraph is built in one go the items are
+    *  taken in order of ID. */
+   template <typename _Item>
+   class LiveSet : public ItemSetTraits<ExtendedListDigraphBase, _Item>::ItemNotifier::ObserverBase {
+   private:
+      typedef typename ItemSetTraits<ExtendedListDigraphBase, _Item>::ItemNotifier Notifier;
+      typedef typename Notifier::ObserverBase Parent;
+
+      const ExtendedListDigraphBase &mDigraph;
+      /** The live items */
+      vector<_Item> mItems;
+      /** Position of each item in mItems, indexed by its ID (-1 if not live) */
+      vector<int>   mPos;
+
+   public:
+      LiveSet (const ExtendedListDigraphBase &digraph) : mDigraph(digraph) {
+         Parent::attach(digraph.notifier(_Item()));
+         build();
+      }
+
+      int size () const { return mItems.size(); }
+      bool empty () const { return mItems.empty(); }
+
+      _Item operator[] (int i) const { return mItems[i]; }
+
+      /** Uniformly random item (INVALID if there are none) */
+      _Item random (Random &rnd) const {
+         if (mItems.empty()) { return INVALID; }
+         return mItems[rnd.integer((int)mItems.size())];
+      }
+
+   protected:
+      virtual void add (const _Item &item) {
+         int id = Parent::notifier()->id(item);
+         if (id >= (int)mPos.size()) { mPos.resize(id + 1, -1); }
+         mPos[id] = mItems.size();
+         mItems.push_back(item);
+      }
+
+      virtual void add (const vector<_Item> &items) {
+         for (int i=0; i<(int)items.size(); ++i) { add(items[i]); }
+      }
+
+      virtual void erase (const _Item &item) {
+         int id = Parent::notifier()->id(item);
+         int pos = mPos[id];
+         _Item last = mItems.back();
+         mItems[pos] = last;
+         mPos[Parent::notifier()->id(last)] = pos;
+         mItems.pop_back();
+         mPos[id] = -1;
+      }
+
+      virtual void erase (const vector<_Item> &items) {
+         for (int i=0; i<(int)items.size(); ++i) { erase(items[i]); }
+      }
+
+      virtual void build () {
+         // Sweep the IDs rather than iterate, which for arcs jumps from node to node
+         int maxId = Parent::notifier()->maxId();
+         mItems.clear();
+         mPos.assign(maxId + 1, -1);
+         for (int id=0; id<=maxId; ++id) {
+            _Item item = mDigraph.fromId(id, _Item());
+            if (mDigraph.valid(item)) {
+               mPos[id] = mItems.size();
+               mItems.push_back(item);
+            }
+         }
+      }
+
+      virtual void clear () {
+         mItems.clear();
+         mPos.clear();
+      }
+   };
+
    class System : public ListDigraph {
    private:
       /** The parent type for systems */
       typedef ListDigraph Parent;
+      
+      /** Maps holding the node and arc data. These keep the data in a vector (LEMON's
+       *  default for structures constructs, moves and destroys each element separately,
+       *  in digraph order), so growing or sizing them is a sequential pass. */
+      typedef VectorMap<ExtendedListDigraphBase, Node, NodeData> NodeDataMap;
+      typedef VectorMap<ExtendedListDigraphBase, Arc, ArcData>   ArcDataMap;
 
       /** Digraphs are not copy constructible. Use copySystem instead. */
       System(const System &) : ListDigraph() { }
       /** Assignment of a digraph to another one is not allowed. Use copySystem instead. */
       void operator=(const System &) { }
       
+      /** Bulk construction where the dynamic of node i is nodeDynamics[i*nodeStride] (and
+       *  likewise for arcs), so a stride of 0 gives every element the same dynamic. */
+      bool build (int numOfNodes, NodeDynamic * const *nodeDynamics, int nodeStride,
+                  const vector< pair<int,int> > &arcList, ArcDynamic * const *arcDynamics, int arcStride);
+      
       /** Given a correctly sized square zero matrix, populates with the laplacian matrix */
       void fillLaplacian (MatrixXd &A);
       /** Given a correctly sized square zero matrix, populates with the adjacency matrix */
       void fillAdjacency (MatrixXd &A);
 
-      /** Number of dynamic states required per node */
+      /** Largest number of dynamic states required by any node dynamic */
       int  mNodeStates;
-      /** Number of dynamic states required per arc */
+      /** Largest number of dynamic states required by any arc dynamic */
       int  mArcStates;
       
-      /** Mapping of Node to int ID (0..max nodes)
-       *  Used to find the start index of a node in a simulation state vector. */
+      /** Number of states of every node and of every arc (found with the state IDs) */
+      int  mNodeStateCount;
+      int  mArcStateCount;
+      
+      /** Data used while simulating, packed into columns in iteration order when the state
+       *  IDs are refreshed (NodeData and ArcData hold the full data). Parameters of each
+       *  node and arc are stored together, starting at its entry in the start column. */
+      vector<Node>         mNodeList;
+      vector<NodeDynamic*> mNodeDynamicList;
+      vector<int>          mNodeParamStart;
+      vector<double>       mNodeParamList;
+      vector<Arc>          mArcList;
+      vector<ArcDynamic*>  mArcDynamicList;
+      vector<int>          mArcParamStart;
+      vector<double>       mArcParamList;
+      vector<double>       mArcWeightList;
+      /** Position of each node and arc in the columns */
+      NodeMap<int> *mNodeIndex;
+      ArcMap<int>  *mArcIndex;
+      
+      /** Mapping of Node to the start index of its states in a simulation state vector.
+       *  States are packed in iteration order, each node taking as many as its dynamic needs. */
       NodeMap<int> *mNodeIDs;
-       /** Mapping of Arc to int ID (0..max arcs)
-        *  Used to find the start index of an arc in a simulation state vector. */
+       /** Mapping of Arc to the start index of its states in a simulation state vector.
+        *  Arc states are packed in the same way, after those of every node. */
       ArcMap<int>  *mArcIDs;
       
       /** Flag specifying if node IDs mapping (mNodeIDs) is up to date */
@@ -142,9 +255,13 @@ namespace netevo {
       bool mValidArcIDs;
       
       /** Node map holding all node properties (name, properties, dynamics) */
-      NodeMap<NodeData> *mNodeData;
+      NodeDataMap *mNodeData;
       /** Arc map holding all arc properties (name, weight, properties, dynamics) */
-      ArcMap<ArcData>   *mArcData;
+      ArcDataMap  *mArcData;
+      
+      /** Dense sets of the live nodes and arcs (for constant time counts and sampling) */
+      LiveSet<Node> *mLiveNodes;
+      LiveSet<Arc>  *mLiveArcs;
 
       /** Internal node dynamics library */
       std::map<string, NodeDynamic*> mNodeDynamics;
@@ -167,10 +284,16 @@ namespace netevo {
       System () : Parent () {
          mNodeStates = 0;
          mArcStates = 0;
-         mNodeData = new NodeMap<NodeData>(*this);
-         mArcData  = new ArcMap<ArcData>(*this);
+         mNodeStateCount = 0;
+         mArcStateCount = 0;
+         mNodeData = new NodeDataMap(*this);
+         mArcData  = new ArcDataMap(*this);
          mNodeIDs = new NodeMap<int>(*this);
          mArcIDs  = new ArcMap<int>(*this);
+         mNodeIndex = new NodeMap<int>(*this);
+         mArcIndex  = new ArcMap<int>(*this);
+         mLiveNodes = new LiveSet<Node>(*this);
+         mLiveArcs  = new LiveSet<Arc>(*this);
          mValidNodeIDs = true;
          mValidArcIDs = true;
          // We include no dynamics as default types for all systems
@@ -190,6 +313,10 @@ namespace netevo {
          delete mArcData;
          delete mNodeIDs;
          delete mArcIDs;
+         delete mNodeIndex;
+         delete mArcIndex;
+         delete mLiveNodes;
+         delete mLiveArcs;
       }
       
       void clear () {
@@ -250,7 +377,7 @@ namespace netevo {
          clear();
          
          // Copy the graph structure
-         digraphCopy(from, *this).nodeRef(nr).arcCrossRef(acr).run();
+         digraphCopy(from, *this).nodeRef(nr).arcRef(acr).run();
 
          // Copy the dynamics library
          mNodeDynamics = *from.getNodeDynamicsMap();
@@ -258,8 +385,8 @@ namespace netevo {
 
          // Copy the node data using the mapping
          for (NodeIt v(from); v != INVALID; ++v) {
-            NodeData &toNodeData = nodeData(nr[v]);
-            NodeData &fromNodeData = from.nodeData(v);
+            NodeData &toNodeData = (*mNodeData)[nr[v]];
+            const NodeData &fromNodeData = from.nodeData(v);
             // Copy fields
             toNodeData.key = fromNodeData.key;
             toNodeData.name = fromNodeData.name;
@@ -273,8 +400,8 @@ namespace netevo {
 
          // Copy the arc data using the mapping
          for (ArcIt e(from); e != INVALID; ++e) {
-            ArcData &toArcData = arcData(acr[e]);
-            ArcData &fromArcData = from.arcData(e);
+            ArcData &toArcData = (*mArcData)[acr[e]];
+            const ArcData &fromArcData = from.arcData(e);
             // Copy fields
             toArcData.name = fromArcData.name;
             toArcData.weight = fromArcData.weight;
@@ -298,19 +425,31 @@ namespace netevo {
       // Used for simulating the dynamics of the system (boost::odeint)
       void operator() (const State &x, State &dx, const double t);
 
+      /** Largest number of states of any node (or arc) dynamic. Each node and arc only has 
+       *  the states its own dynamic needs. */
       int nodeStates () { return mNodeStates; }
       int arcStates  () { return mArcStates; }
 
       int nextKey () { return mNextKey; }
       void resetKeys ();
       
-      NodeData & nodeData (Node v) { return (*mNodeData)[v]; }
-      ArcData &  arcData  (Arc e) { return (*mArcData)[e]; }
+      /** Read the data of a node or arc */
+      const NodeData & nodeData (Node v) { return (*mNodeData)[v]; }
+      const ArcData &  arcData  (Arc e) { return (*mArcData)[e]; }
+      /** Change the data of a node or arc. The values used while simulating are gathered from 
+       *  the data when the state IDs are refreshed, so this marks them out of date; do not keep 
+       *  the reference past the next refresh (use setArcWeight to only change a weight). */
+      NodeData & editNodeData (Node v) { invalidateStateIDs(); return (*mNodeData)[v]; }
+      ArcData &  editArcData  (Arc e) { mValidArcIDs = false; return (*mArcData)[e]; }
 
       // Getter methods for the node and arc dynamics library (don't think this is required)
       std::map<string, NodeDynamic*> * getNodeDynamicsMap () { return &mNodeDynamics; }
       std::map<string, ArcDynamic*> * getArcDynamicsMap () { return &mArcDynamics; }
       
+      /** Find a dynamic in the library once, e.g. for use with build (NULL if not found) */
+      NodeDynamic * getNodeDynamic (string name);
+      ArcDynamic *  getArcDynamic  (string name);
+      
       void addNodeDynamic (NodeDynamic *nodeDynamic);
       void addArcDynamic  (ArcDynamic  *arcDynamic);
 
@@ -327,23 +466,78 @@ namespace netevo {
       Edge addEdge (Node u, Node v, string dynamic);
       Edge addEdge (Node u, Node v, string name, string dynamic);
       
+      /** Bulk construction
+       *  Replaces the System with nodes having the given dynamics (one per node) and arcs
+       *  between them given as pairs of node indexes (source, target), each with the given
+       *  dynamic (one per arc). Nodes and arcs are created in order, so node i and arc k can
+       *  be found with nodeFromId(i) and arcFromId(k). The result is the same as adding each
+       *  node and then each arc with addNode and addArc, but the structure is laid out in a 
+       *  single pass and every map sized once, which is far faster for large systems. 
+       *  Returns false, leaving the System unchanged, if an arc joins a node index outside 
+       *  [0, number of nodes), a dynamic is NULL or there is not one dynamic per arc. */
+      bool build (const vector<NodeDynamic*> &nodeDynamics, const vector< pair<int,int> > &arcList,
+                  const vector<ArcDynamic*> &arcDynamics);
+      /** Bulk construction with the same dynamic for every node and for every arc. */
+      bool build (int numOfNodes, NodeDynamic *nodeDynamic, const vector< pair<int,int> > &arcList,
+                  ArcDynamic *arcDynamic);
+      
+      // Remove nodes (and their arcs) and arcs. These must be used rather than those of the
+      // ListDigraph so that the counts and state IDs are kept up to date.
+      void erase (Node v);
+      void erase (Arc e);
+      
+      /** The node (or arc) reached after ID steps of iterating over the System. This takes 
+       *  O(ID) steps, so use liveNode or randomNode where the order does not matter. */
       Node getNode (int ID);
       Arc  getArc  (int ID);
       
+      /** Number of nodes and arcs (constant time) */
+      int nodeCount () { return mLiveNodes->size(); }
+      int arcCount  () { return mLiveArcs->size(); }
+      /** The i-th of the live nodes (or arcs), for 0 <= i < nodeCount(), in constant time. The 
+       *  order is not that of iteration and changes as nodes and arcs are removed. */
+      Node liveNode (int i) { return (*mLiveNodes)[i]; }
+      Arc  liveArc  (int i) { return (*mLiveArcs)[i]; }
+      /** Uniformly random node (or arc) in constant time (INVALID if there are none) */
+      Node randomNode (Random &rnd) { return mLiveNodes->random(rnd); }
+      Arc  randomArc  (Random &rnd) { return mLiveArcs->random(rnd); }
+      Node randomNode () { return randomNode(mRnd); }
+      Arc  randomArc  () { return randomArc(mRnd); }
+      
       /** Whether the current state IDs are valid */
       bool validStateIDs ();
       /** Force a recalculation of the state IDs */
       void refreshStateIDs ();
+      /** Mark the state IDs out of date (done by editNodeData and editArcData, as the number of 
+       *  states may change and the values used while simulating are only gathered when the IDs 
+       *  are refreshed) */
+      void invalidateStateIDs () { mValidNodeIDs = false; mValidArcIDs = false; }
+      
+      /** Fast access to the dynamic parameters of a node or arc and the weight of an arc while
+       *  simulating (valid once refreshStateIDs has been called). */
+      const double * nodeParams (Node v) { return mNodeParamList.data() + mNodeParamStart[(*mNodeIndex)[v]]; }
+      const double * arcParams  (Arc e) { return mArcParamList.data() + mArcParamStart[(*mArcIndex)[e]]; }
+      double arcWeight (Arc e) { return mArcWeightList[(*mArcIndex)[e]]; }
+      /** Set the weight of an arc (in its data and, if the IDs are valid, for simulating) */
+      void setArcWeight (Arc e, double weight) {
+         (*mArcData)[e].weight = weight;
+         if (mValidArcIDs) { mArcWeightList[(*mArcIndex)[e]] = weight; }
+      }
       
       /** Total number of states to simulate this System. */
-      int totalStates () { return ((mNodeStates * countNodes(*this)) + (mArcStates * countArcs(*this))); }
+      int totalStates () {
+         if (!validStateIDs()) { refreshStateIDs(); }
+         return (mNodeStateCount + mArcStateCount);
+      }
       
       /** State ID for a given node
-       *  Calculates the index for the node in any dynamical state vector. */
-      int stateID (Node v);
+       *  The index for the node in any dynamical state vector (valid once refreshStateIDs has 
+       *  been called after any change to the structure). */
+      int stateID (Node v) { return (*mNodeIDs)[v]; }
       /** State ID for a given arc
-       *  Calculates the index for the arc in any dynamical state vector. */
-      int stateID (Arc e);
+       *  The index for the arc in any dynamical state vector (valid once refreshStateIDs has 
+       *  been called after any change to the structure). */
+      int stateID (Arc e) { return (*mArcIDs)[e]; }
 
       /** Save a System to a GML file
        *  We use GML as the native file format enabling systems created with NetEvo to be used 
@@ -393,7 +587,7 @@ namespace netevo {
    };
    
    /** Logs the changes that occur to a System. Used for export and visualisation. Should be called before 
-    *  an update is made the actual System. */
+    *  an update is made the actual System, except for addNode which is given the new node once added. */
    class ChangeLog {
    public:
       virtual void addNode  (System &sys, Node n) { };